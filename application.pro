@@ -0,0 +1,27 @@
+include( config.pri )
+initializeProject( app, $${BUILD_TARGET}, $${BUILD_MODE}, $${BUILD_PATH}/$${BUILD_TARGET}, $${BUILD_TARGET_PATH}, "" )
+
+# headless by default, CONFIG+=gui_frontend adds a directory chooser dialog
+QT = core
+
+gui_frontend {
+    QT *= gui
+    DEFINES *= GUI_FRONTEND
+} else {
+    CONFIG -= windows x11
+    CONFIG *= console
+}
+
+INCLUDEPATH *= $$getFolders( . )
+DEPENDPATH *= $${INCLUDEPATH}
+
+LIBS *= -L$${BUILD_TARGET_PATH}
+CONFIG( debug, debug|release ) {
+    LIBS *= -l$${BUILD_LIBRARY_TARGET}_debug
+} else {
+    LIBS *= -l$${BUILD_LIBRARY_TARGET}
+}
+
+HEADERS *= src/TimeTracker.h
+
+SOURCES *= src/main.cpp
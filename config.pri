@@ -4,11 +4,20 @@
 include( qmake-extensions.git/qmake-extensions.pri )
 
 BUILD_TARGET = document-properties-discover
+BUILD_LIBRARY_TARGET = documentpropertiesdiscover
 BUILD_PATH = build/$${BUILD_TARGET}
 BUILD_TARGET_PATH = bin/$${Q_TARGET}
 BUILD_MODE = debug
 BUILD_TYPE = shared
 
+isEqual( BUILD_TYPE, static ):DEFINES *= DPD_STATIC
+
+# batched file reads using io_uring, disable with CONFIG+=no_io_uring
+linux-*:!no_io_uring:exists( /usr/include/liburing.h ) {
+    DEFINES *= HAVE_IO_URING
+    LIBS *= -luring
+}
+
 # Initialize a project
 # $$1 = template (app or lib)
 # $$2 = target name (in release name)
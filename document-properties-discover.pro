@@ -17,13 +17,8 @@
 XUP.QT_VERSION = Qt System (4.8.1)
 XUP.OTHERS_PLATFORM_TARGET_DEFAULT = /ramdisk/document-properties-discover/bin/Linux/document-properties-discover_debug
 
-include( config.pri )
-initializeProject( app, $${BUILD_TARGET}, $${BUILD_MODE}, $${BUILD_PATH}/$${TARGET_NAME}, $${BUILD_TARGET_PATH}, "" )
-
-INCLUDEPATH *= $$getFolders( . )
-DEPENDPATH *= $${INCLUDEPATH}
-
-HEADERS *= src/DocumentPropertiesDiscover.h
-
-SOURCES *= src/main.cpp \
-    src/DocumentPropertiesDiscover.cpp
\ No newline at end of file
+# the detection / conversion library and the application using it
+TEMPLATE = subdirs
+CONFIG *= ordered
+SUBDIRS = library.pro \
+    application.pro
@@ -0,0 +1,26 @@
+# detection and conversion library, shared by default, build it static with BUILD_TYPE = static
+
+include( config.pri )
+initializeProject( lib, $${BUILD_LIBRARY_TARGET}, $${BUILD_MODE}, $${BUILD_PATH}/$${BUILD_LIBRARY_TARGET}, $${BUILD_TARGET_PATH}, "" )
+
+# the core only needs QtCore, so headless workers don't load the gui stack
+# initializeProject() adds x11 which links libX11 and libXext, drop it too
+QT = core
+CONFIG -= x11
+DEFINES *= DPD_BUILD_LIBRARY
+
+INCLUDEPATH *= $$getFolders( . )
+DEPENDPATH *= $${INCLUDEPATH}
+
+HEADERS *= src/DocumentPropertiesDiscover.h \
+    src/DocumentPropertiesDiscoverPrivate.h \
+    src/DocumentPropertiesDiscoverC.h \
+    src/DocumentPropertiesWatcher.h \
+    src/BatchFileReader.h \
+    src/EditorConfig.h
+
+SOURCES *= src/DocumentPropertiesDiscover.cpp \
+    src/DocumentPropertiesDiscoverC.cpp \
+    src/DocumentPropertiesWatcher.cpp \
+    src/BatchFileReader.cpp \
+    src/EditorConfig.cpp
@@ -0,0 +1,422 @@
+#include "BatchFileReader.h"
+
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QVector>
+
+#include <climits>
+
+#if defined( Q_OS_UNIX )
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined( HAVE_IO_URING )
+#include <liburing.h>
+#endif
+
+namespace DocumentPropertiesDiscover {
+    // first read size of the io_uring backend for files reporting no size
+    const int initialReadSize = 64 *1024;
+    
+    int threadCount( int queueDepth ) {
+        // blocking reads spend most of their time waiting, use more threads than cores
+        return qMax( QThread::idealThreadCount(), qMin( queueDepth, QThread::idealThreadCount() *4 ) );
+    }
+    
+    QByteArray readFile( DocumentPropertiesDiscover::FileBufferHandler* handler, int index, const QString& filePath, qint64 maximumSize, DocumentPropertiesDiscover::FileBufferHandler::Status& status ) {
+        const int prefixSize = handler->prefixSize();
+        status = DocumentPropertiesDiscover::FileBufferHandler::Failed;
+
+#if defined( Q_OS_UNIX )
+        const int fd = ::open( QFile::encodeName( filePath ).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC );
+        
+        if ( fd == -1 ) {
+            return QByteArray();
+        }
+        
+        struct stat info;
+        
+        if ( ::fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) ) {
+            ::close( fd );
+            return QByteArray();
+        }
+        
+        if ( info.st_size >= maximumSize || info.st_size >= INT_MAX ) {
+            ::close( fd );
+            status = DocumentPropertiesDiscover::FileBufferHandler::TooLarge;
+            return QByteArray();
+        }
+        
+        const int size = int( info.st_size );
+        // the prefix is read first, the buffer only grows to the file size once the handler accepted it
+        bool accepted = prefixSize <= 0;
+        bool shrunk = false;
+        QByteArray data;
+        int offset = 0;
+        
+        data.resize( accepted ? size : qMin( prefixSize, size ) );
+        
+        forever {
+            while ( offset < data.size() ) {
+                const ssize_t read = ::pread( fd, data.data() +offset, data.size() -offset, offset );
+                
+                if ( read == -1 ) {
+                    if ( errno == EINTR ) {
+                        continue;
+                    }
+                    
+                    ::close( fd );
+                    return QByteArray();
+                }
+                
+                // the file shrunk
+                if ( read == 0 ) {
+                    data.resize( offset );
+                    shrunk = true;
+                    break;
+                }
+                
+                offset += read;
+            }
+            
+            if ( accepted ) {
+                break;
+            }
+            
+            accepted = true;
+            
+            if ( !handler->acceptPrefix( index, data ) ) {
+                ::close( fd );
+                status = DocumentPropertiesDiscover::FileBufferHandler::Rejected;
+                return data;
+            }
+            
+            if ( shrunk ) {
+                break;
+            }
+            
+            data.resize( size );
+        }
+        
+        ::close( fd );
+        status = DocumentPropertiesDiscover::FileBufferHandler::Read;
+        return data;
+#else
+        QFile file( filePath );
+        
+        if ( !file.exists() || !file.open( QIODevice::ReadOnly ) ) {
+            return QByteArray();
+        }
+        
+        if ( file.size() >= maximumSize ) {
+            status = DocumentPropertiesDiscover::FileBufferHandler::TooLarge;
+            return QByteArray();
+        }
+        
+        if ( prefixSize > 0 ) {
+            const QByteArray prefix = file.peek( prefixSize );
+            
+            if ( !handler->acceptPrefix( index, prefix ) ) {
+                status = DocumentPropertiesDiscover::FileBufferHandler::Rejected;
+                return prefix;
+            }
+        }
+        
+        status = DocumentPropertiesDiscover::FileBufferHandler::Read;
+        return file.readAll();
+#endif
+    }
+    
+    // read a file with blocking calls and handle it, used by the thread pool backend
+    class FileReadRunnable : public QRunnable {
+    public:
+        FileReadRunnable( DocumentPropertiesDiscover::FileBufferHandler* _handler, int _index, const QString& _filePath, qint64 _maximumSize ) {
+            handler = _handler;
+            index = _index;
+            filePath = _filePath;
+            maximumSize = _maximumSize;
+        }
+        
+        virtual void run() {
+            DocumentPropertiesDiscover::FileBufferHandler::Status status;
+            const QByteArray data = DocumentPropertiesDiscover::readFile( handler, index, filePath, maximumSize, status );
+            handler->handleFileBuffer( index, status, data );
+        }
+    
+    protected:
+        DocumentPropertiesDiscover::FileBufferHandler* handler;
+        int index;
+        QString filePath;
+        qint64 maximumSize;
+    };
+    
+    void readFilesBlocking( const QStringList& filePaths, DocumentPropertiesDiscover::FileBufferHandler* handler, qint64 maximumSize, int queueDepth ) {
+        QThreadPool pool;
+        pool.setMaxThreadCount( DocumentPropertiesDiscover::threadCount( queueDepth ) );
+        
+        for ( int i = 0; i < filePaths.count(); i++ ) {
+            pool.start( new DocumentPropertiesDiscover::FileReadRunnable( handler, i, filePaths[ i ], maximumSize ) );
+        }
+        
+        pool.waitForDone();
+    }
+
+#if defined( HAVE_IO_URING )
+    // hand a buffer read by io_uring to the handler, outside of the submission thread
+    class FileBufferRunnable : public QRunnable {
+    public:
+        FileBufferRunnable( DocumentPropertiesDiscover::FileBufferHandler* _handler, QSemaphore* _pending, int _index, DocumentPropertiesDiscover::FileBufferHandler::Status _status, const QByteArray& _data ) {
+            handler = _handler;
+            pending = _pending;
+            index = _index;
+            status = _status;
+            data = _data;
+        }
+        
+        virtual void run() {
+            handler->handleFileBuffer( index, status, data );
+            pending->release();
+        }
+    
+    protected:
+        DocumentPropertiesDiscover::FileBufferHandler* handler;
+        QSemaphore* pending;
+        int index;
+        DocumentPropertiesDiscover::FileBufferHandler::Status status;
+        QByteArray data;
+    };
+    
+    struct UringRequest {
+        enum Stage {
+            Stat,
+            Open,
+            Read,
+            Close
+        };
+        
+        int index;
+        int fd;
+        DocumentPropertiesDiscover::UringRequest::Stage stage;
+        QByteArray path;
+        struct statx info;
+        QByteArray data;
+        int offset;
+        int fileSize; // -1 when the file reports no size
+        bool accepted;
+        
+        int bufferSize( int maximumBufferSize ) const {
+            // files reporting no size ( procfs... ) start small and are read until a read returns nothing
+            return fileSize != -1 ? fileSize : qMin( DocumentPropertiesDiscover::initialReadSize, maximumBufferSize );
+        }
+    };
+    
+    bool uringSupported( io_uring* ring ) {
+        io_uring_probe* probe = io_uring_get_probe_ring( ring );
+        
+        if ( !probe ) {
+            return false;
+        }
+        
+        const bool supported =
+            io_uring_opcode_supported( probe, IORING_OP_STATX ) &&
+            io_uring_opcode_supported( probe, IORING_OP_OPENAT ) &&
+            io_uring_opcode_supported( probe, IORING_OP_READ ) &&
+            io_uring_opcode_supported( probe, IORING_OP_CLOSE )
+        ;
+        
+        io_uring_free_probe( probe );
+        return supported;
+    }
+    
+    bool readFilesUring( const QStringList& filePaths, DocumentPropertiesDiscover::FileBufferHandler* handler, qint64 maximumSize, int queueDepth ) {
+        io_uring ring;
+        
+        if ( io_uring_queue_init( queueDepth, &ring, 0 ) < 0 ) {
+            return false;
+        }
+        
+        if ( !DocumentPropertiesDiscover::uringSupported( &ring ) ) {
+            io_uring_queue_exit( &ring );
+            return false;
+        }
+        
+        const int prefixSize = handler->prefixSize();
+        // finished buffers are handled by a pool, the semaphore stops reading when the pool lags behind
+        QSemaphore pending( QThread::idealThreadCount() *4 );
+        QThreadPool pool;
+        const int maximumBufferSize = int( qMin( maximumSize, qint64( INT_MAX ) ) );
+        // each request has at most one sqe in flight, so the ring never runs out of sqe
+        QVector<DocumentPropertiesDiscover::UringRequest> requests( queueDepth );
+        QVector<DocumentPropertiesDiscover::UringRequest*> freeRequests;
+        int next = 0;
+        
+        for ( int i = 0; i < requests.count(); i++ ) {
+            freeRequests << &requests[ i ];
+        }
+        
+        while ( next < filePaths.count() || freeRequests.count() < requests.count() ) {
+            while ( next < filePaths.count() && !freeRequests.isEmpty() ) {
+                DocumentPropertiesDiscover::UringRequest* request = freeRequests.last();
+                io_uring_sqe* sqe = io_uring_get_sqe( &ring );
+                
+                freeRequests.removeLast();
+                request->index = next++;
+                request->fd = -1;
+                request->stage = DocumentPropertiesDiscover::UringRequest::Stat;
+                request->path = QFile::encodeName( filePaths[ request->index ] );
+                request->offset = 0;
+                
+                // like readFile(), reject special files and big files before opening them, without blocking the submit loop
+                io_uring_prep_statx( sqe, AT_FDCWD, request->path.constData(), 0, STATX_TYPE | STATX_SIZE, &request->info );
+                io_uring_sqe_set_data( sqe, request );
+            }
+            
+            io_uring_submit_and_wait( &ring, 1 );
+            
+            io_uring_cqe* cqe = 0;
+            
+            while ( io_uring_peek_cqe( &ring, &cqe ) == 0 ) {
+                DocumentPropertiesDiscover::UringRequest* request = static_cast<DocumentPropertiesDiscover::UringRequest*>( io_uring_cqe_get_data( cqe ) );
+                const int result = cqe->res;
+                bool finished = false;
+                DocumentPropertiesDiscover::FileBufferHandler::Status status = DocumentPropertiesDiscover::FileBufferHandler::Failed;
+                
+                io_uring_cqe_seen( &ring, cqe );
+                
+                switch ( request->stage ) {
+                    case DocumentPropertiesDiscover::UringRequest::Stat:
+                        if ( result < 0 || !S_ISREG( request->info.stx_mode ) ) {
+                            finished = true;
+                        }
+                        else if ( request->info.stx_size >= quint64( maximumBufferSize ) ) {
+                            status = DocumentPropertiesDiscover::FileBufferHandler::TooLarge;
+                            finished = true;
+                        }
+                        
+                        if ( finished ) {
+                            pending.acquire();
+                            pool.start( new DocumentPropertiesDiscover::FileBufferRunnable( handler, &pending, request->index, status, QByteArray() ) );
+                            freeRequests << request;
+                            continue;
+                        }
+                        
+                        request->stage = DocumentPropertiesDiscover::UringRequest::Open;
+                        break;
+                    case DocumentPropertiesDiscover::UringRequest::Open:
+                        if ( result < 0 ) {
+                            pending.acquire();
+                            pool.start( new DocumentPropertiesDiscover::FileBufferRunnable( handler, &pending, request->index, status, QByteArray() ) );
+                            freeRequests << request;
+                            continue;
+                        }
+                        
+                        request->fd = result;
+                        request->stage = DocumentPropertiesDiscover::UringRequest::Read;
+                        request->fileSize = request->info.stx_size > 0 ? int( request->info.stx_size ) : -1;
+                        // only the prefix is read until the handler accepts it
+                        request->accepted = prefixSize <= 0;
+                        request->data.resize( request->accepted ? request->bufferSize( maximumBufferSize ) : qMin( prefixSize, request->bufferSize( maximumBufferSize ) ) );
+                        break;
+                    case DocumentPropertiesDiscover::UringRequest::Read: {
+                        if ( result < 0 ) {
+                            finished = true;
+                            break;
+                        }
+                        
+                        request->offset += result;
+                        
+                        if ( request->offset >= maximumBufferSize ) {
+                            status = DocumentPropertiesDiscover::FileBufferHandler::TooLarge;
+                            finished = true;
+                            break;
+                        }
+                        
+                        // like readFile(), stop at the size the file had when it was stat'ed, a short read only means reading again
+                        const bool end = result == 0 || request->offset == request->fileSize;
+                        
+                        if ( end ) {
+                            request->data.resize( request->offset );
+                        }
+                        else if ( request->offset < request->data.size() ) {
+                            break;
+                        }
+                        
+                        if ( !request->accepted ) {
+                            request->accepted = true;
+                            
+                            if ( !handler->acceptPrefix( request->index, request->data ) ) {
+                                status = DocumentPropertiesDiscover::FileBufferHandler::Rejected;
+                                finished = true;
+                                break;
+                            }
+                            
+                            if ( !end && request->bufferSize( maximumBufferSize ) > request->data.size() ) {
+                                request->data.resize( request->bufferSize( maximumBufferSize ) );
+                                break;
+                            }
+                        }
+                        
+                        if ( end ) {
+                            status = DocumentPropertiesDiscover::FileBufferHandler::Read;
+                            finished = true;
+                            break;
+                        }
+                        
+                        // buffer full, the file reports no size
+                        request->data.resize( qMin( request->data.size() *2, maximumBufferSize ) );
+                        break;
+                    }
+                    case DocumentPropertiesDiscover::UringRequest::Close:
+                        freeRequests << request;
+                        continue;
+                }
+                
+                io_uring_sqe* sqe = io_uring_get_sqe( &ring );
+                
+                if ( finished ) {
+                    pending.acquire();
+                    pool.start( new DocumentPropertiesDiscover::FileBufferRunnable( handler, &pending, request->index, status, status == DocumentPropertiesDiscover::FileBufferHandler::Read || status == DocumentPropertiesDiscover::FileBufferHandler::Rejected ? request->data : QByteArray() ) );
+                    request->data = QByteArray();
+                    request->stage = DocumentPropertiesDiscover::UringRequest::Close;
+                    io_uring_prep_close( sqe, request->fd );
+                }
+                else if ( request->stage == DocumentPropertiesDiscover::UringRequest::Open ) {
+                    io_uring_prep_openat( sqe, AT_FDCWD, request->path.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC, 0 );
+                }
+                else {
+                    io_uring_prep_read( sqe, request->fd, request->data.data() +request->offset, request->data.size() -request->offset, request->offset );
+                }
+                
+                io_uring_sqe_set_data( sqe, request );
+            }
+        }
+        
+        io_uring_queue_exit( &ring );
+        pool.waitForDone();
+        return true;
+    }
+#endif
+}
+
+void DocumentPropertiesDiscover::readFiles( const QStringList& filePaths, DocumentPropertiesDiscover::FileBufferHandler* handler, qint64 maximumSize, int queueDepth )
+{
+    if ( filePaths.isEmpty() || !handler ) {
+        return;
+    }
+    
+    queueDepth = qMax( 1, queueDepth );
+
+#if defined( HAVE_IO_URING )
+    if ( qgetenv( "DPD_NO_IO_URING" ).isEmpty() && DocumentPropertiesDiscover::readFilesUring( filePaths, handler, maximumSize, queueDepth ) ) {
+        return;
+    }
+#endif
+
+    DocumentPropertiesDiscover::readFilesBlocking( filePaths, handler, maximumSize, queueDepth );
+}
@@ -0,0 +1,42 @@
+#ifndef BATCHFILEREADER_H
+#define BATCHFILEREADER_H
+
+#include "DocumentPropertiesDiscover.h"
+
+namespace DocumentPropertiesDiscover
+{
+    class DOCUMENTPROPERTIESDISCOVER_EXPORT FileBufferHandler {
+    public:
+        enum Status {
+            Read, // data holds the whole file content
+            Failed, // the file can't be read
+            TooLarge, // the file is bigger than the maximum size and has not been read
+            Rejected // acceptPrefix() refused the file, data holds its prefix only
+        };
+        
+        virtual ~FileBufferHandler() {}
+        
+        // bytes handed to acceptPrefix() before the rest of each file is read, 0 reads files at once
+        virtual int prefixSize() const { return 0; }
+        
+        // called with the first prefixSize() bytes of each file ( the whole file when smaller ), possibly from the reading thread so keep it cheap
+        virtual bool acceptPrefix( int index, const QByteArray& prefix ) {
+            Q_UNUSED( index );
+            Q_UNUSED( prefix );
+            return true;
+        }
+        
+        // called once per file as soon as its content is read, possibly concurrently from several threads
+        virtual void handleFileBuffer( int index, DocumentPropertiesDiscover::FileBufferHandler::Status status, const QByteArray& data ) = 0;
+    };
+    
+    /*
+        Read filePaths keeping up to queueDepth open/read requests in flight and hand each buffer to handler.
+        Linux builds with liburing use io_uring, other builds (or kernels without io_uring) use a thread pool of blocking reads.
+        Setting the DPD_NO_IO_URING environment variable forces the thread pool, to compare both backends.
+        Returns once every file has been handled.
+    */
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void readFiles( const QStringList& filePaths, DocumentPropertiesDiscover::FileBufferHandler* handler, qint64 maximumSize, int queueDepth = 64 );
+};
+
+#endif // BATCHFILEREADER_H
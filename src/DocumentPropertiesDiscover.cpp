@@ -1,10 +1,29 @@
 #include "DocumentPropertiesDiscover.h"
+#include "DocumentPropertiesDiscoverPrivate.h"
+#include "BatchFileReader.h"
+#include "EditorConfig.h"
 
 #include <QString>
 #include <QRegExp>
 #include <QTextCodec>
 #include <QFile>
+#include <QFileInfo>
+#include <QTextDecoder>
+#include <QScopedPointer>
 #include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+
+#include <climits>
+#include <cstring>
 
 DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::GuessedProperties::null(
     DocumentPropertiesDiscover::UndefinedEol,
@@ -53,25 +72,454 @@ namespace DocumentPropertiesDiscover {
     DocumentPropertiesDiscover::Indent _defaultIndent = DocumentPropertiesDiscover::SpacesIndent;
     int _defaultIndentWidth = 4;
     int _defaultTabWidth = 4;
+    // the decoded content takes twice the file size, and QByteArray can't hold INT_MAX bytes
+    const qint64 maximumLargeFileThreshold = 256 *1024 *1024;
+    qint64 _largeFileThreshold = 64 *1024 *1024;
+    bool _editorConfigEnabled = false;
+    bool _contentDeduplicationEnabled = false;
+    bool _binaryDetectionEnabled = true;
+    int _binaryDetectionPrefixSize = 8000;
+    
+    // streaming parser window
+    const int streamChunkSize = 64 *1024;
+    const int streamMaximumLineLength = 4 *1024;
+    
+    // parsing state, one instance per parsed content so that several contents can be parsed concurrently
+    struct ParseContext {
+        ParseContext() {
+            nb_processed_lines = 0;
+            nb_indent_hint = 0;
+            indent_re = QRegExp( "^([ \t]+)([^ \t]+)" );
+            mixed_re = QRegExp( "^(\t+)( +)$" );
+            skip_next_line = false;
+        }
+        
+        QHash<QString, qint64> lines;
+        QHash<DocumentPropertiesDiscover::Eol, qint64> eols;
+        qint64 nb_processed_lines;
+        qint64 nb_indent_hint;
+        QRegExp indent_re;
+        QRegExp mixed_re;
+        bool skip_next_line;
+        DocumentPropertiesDiscover::LineInfo previous_line_info;
+    };
+    
+    struct MagicNumber {
+        const char* bytes;
+        int size;
+    };
+    
+    // leading bytes of common binary formats, text like ones ( scripts, svg, ... ) are left out on purpose
+    const DocumentPropertiesDiscover::MagicNumber magicNumbers[] = {
+        { "\x89PNG\r\n\x1a\n", 8 }, // png
+        { "\xff\xd8\xff", 3 }, // jpeg
+        { "GIF87a", 6 },
+        { "GIF89a", 6 },
+        { "%PDF-", 5 },
+        { "PK\x03\x04", 4 }, // zip, jar, office documents
+        { "\x1f\x8b", 2 }, // gzip
+        { "\xfd" "7zXZ\x00", 6 }, // xz
+        { "7z\xbc\xaf\x27\x1c", 6 }, // 7z
+        { "(\xb5/\xfd", 4 }, // zstd
+        { "\x7f" "ELF", 4 },
+        { "\xfe\xed\xfa\xce", 4 }, // mach-o
+        { "\xfe\xed\xfa\xcf", 4 },
+        { "\xce\xfa\xed\xfe", 4 },
+        { "\xcf\xfa\xed\xfe", 4 },
+        { "\xca\xfe\xba\xbe", 4 }, // java class, mach-o universal
+        { "SQLite format 3\x00", 16 }
+    };
+    
+    DocumentPropertiesDiscover::GuessedProperties binaryGuessedProperties() {
+        DocumentPropertiesDiscover::GuessedProperties properties = DocumentPropertiesDiscover::GuessedProperties::null;
+        properties.binary = true;
+        return properties;
+    }
+    
+    // UTF-16 and UTF-32 texts are full of NUL bytes
+    bool isWideCodec( const QByteArray& codecName ) {
+        QTextCodec* codec = QTextCodec::codecForName( codecName );
+        
+        if ( !codec ) {
+            return false;
+        }
+        
+        switch ( codec->mibEnum() ) {
+            case 1013: // UTF-16BE
+            case 1014: // UTF-16LE
+            case 1015: // UTF-16
+            case 1017: // UTF-32
+            case 1018: // UTF-32BE
+            case 1019: // UTF-32LE
+                return true;
+            default:
+                return false;
+        }
+    }
+    
+    // data is the content, or its first bytes, of a document decoded with codec
+    bool isBinaryContent( const QByteArray& data, const QByteArray& codec ) {
+        return
+            DocumentPropertiesDiscover::binaryDetectionEnabled() &&
+            !DocumentPropertiesDiscover::isWideCodec( codec ) &&
+            DocumentPropertiesDiscover::isBinaryData( data )
+        ;
+    }
     
-    QHash<QString, int> lines;
-    QHash<DocumentPropertiesDiscover::Eol, int> eols;
-    int nb_processed_lines;
-    int nb_indent_hint;
-    QRegExp indent_re;
-    QRegExp mixed_re;
-    bool skip_next_line;
-    DocumentPropertiesDiscover::LineInfo previous_line_info;
+    // the detection itself, data is known to be text
+    DocumentPropertiesDiscover::GuessedProperties guessTextData( const QByteArray& data, bool detectEol, bool detectIndent, const QByteArray& codec, DocumentPropertiesDiscover::Counters* counters );
+    DocumentPropertiesDiscover::GuessedProperties guessTextDevice( QIODevice* device, bool detectEol, bool detectIndent, const QByteArray& codec, DocumentPropertiesDiscover::Counters* counters );
     
-    int linesMax( const QString& key ) {
-        int value = -1;
+    // the .editorconfig declared properties of filePath, detectEol and detectIndent are cleared when declared
+    DocumentPropertiesDiscover::EditorConfigProperties declaredProperties( const QString& filePath, bool& detectEol, bool& detectIndent ) {
+        if ( !DocumentPropertiesDiscover::editorConfigEnabled() ) {
+            return DocumentPropertiesDiscover::EditorConfigProperties();
+        }
+        
+        const DocumentPropertiesDiscover::EditorConfigProperties properties = DocumentPropertiesDiscover::editorConfigProperties( filePath );
+        detectEol = detectEol && !properties.hasEol();
+        detectIndent = detectIndent && !properties.hasIndent();
+        return properties;
+    }
+    
+    DocumentPropertiesDiscover::GuessedProperties guessFile( const QString& filePath, bool detectEol, bool detectIndent, const QByteArray& codec, DocumentPropertiesDiscover::Counters* counters, DocumentPropertiesDiscover::FileOutcome& outcome ) {
+        const DocumentPropertiesDiscover::EditorConfigProperties declared = DocumentPropertiesDiscover::declaredProperties( filePath, detectEol, detectIndent );
+        
+        // everything is declared, don't touch the file
+        if ( !declared.isEmpty() && !detectEol && !detectIndent ) {
+            outcome = DocumentPropertiesDiscover::DeclaredFile;
+            return declared.merged( DocumentPropertiesDiscover::GuessedProperties() );
+        }
+        
+        QFile file( filePath );
+        
+        // devices and pipes may never end
+        if ( !QFileInfo( filePath ).isFile() || !file.open( QIODevice::ReadOnly ) ) {
+            outcome = DocumentPropertiesDiscover::FailedFile;
+            return declared.merged( DocumentPropertiesDiscover::GuessedProperties() );
+        }
+        
+        // the peeked bytes stay buffered for the reads below
+        if ( DocumentPropertiesDiscover::isBinaryContent( file.peek( DocumentPropertiesDiscover::binaryDetectionPrefixSize() ), codec ) ) {
+            outcome = DocumentPropertiesDiscover::BinaryFile;
+            return DocumentPropertiesDiscover::GuessedProperties::binaryContent;
+        }
+        
+        outcome = DocumentPropertiesDiscover::GuessedFile;
+        
+        // don't load big files in memory
+        if ( file.size() >= DocumentPropertiesDiscover::largeFileThreshold() ) {
+            return declared.merged( DocumentPropertiesDiscover::guessTextDevice( &file, detectEol, detectIndent, codec, counters ) );
+        }
+        
+        return declared.merged( DocumentPropertiesDiscover::guessTextData( file.readAll(), detectEol, detectIndent, codec, counters ) );
+    }
+    
+    // MurmurHash64A, a fast non cryptographic hash
+    quint64 contentHash( const QByteArray& data ) {
+        const quint64 m = Q_UINT64_C( 0xc6a4a7935bd1e995 );
+        const int r = 47;
+        const int length = data.size();
+        const int blocks = length /8;
+        const uchar* bytes = reinterpret_cast<const uchar*>( data.constData() );
+        quint64 h = Q_UINT64_C( 0x9e3779b97f4a7c15 ) ^ ( quint64( length ) *m );
+        
+        for ( int i = 0; i < blocks; i++ ) {
+            quint64 k;
+            memcpy( &k, bytes +i *8, sizeof( k ) );
+            
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+            
+            h ^= k;
+            h *= m;
+        }
+        
+        const uchar* tail = bytes +blocks *8;
+        
+        switch ( length & 7 ) {
+            case 7: h ^= quint64( tail[ 6 ] ) << 48;
+                // fall through
+            case 6: h ^= quint64( tail[ 5 ] ) << 40;
+                // fall through
+            case 5: h ^= quint64( tail[ 4 ] ) << 32;
+                // fall through
+            case 4: h ^= quint64( tail[ 3 ] ) << 24;
+                // fall through
+            case 3: h ^= quint64( tail[ 2 ] ) << 16;
+                // fall through
+            case 2: h ^= quint64( tail[ 1 ] ) << 8;
+                // fall through
+            case 1: h ^= quint64( tail[ 0 ] );
+                h *= m;
+        }
+        
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        
+        return h;
+    }
+    
+    // identifies a content and the detection asked for it
+    struct ContentKey {
+        bool operator==( const DocumentPropertiesDiscover::ContentKey& other ) const {
+            return
+                hash == other.hash &&
+                size == other.size &&
+                detectEol == other.detectEol &&
+                detectIndent == other.detectIndent
+            ;
+        }
+        
+        quint64 hash;
+        int size;
+        bool detectEol;
+        bool detectIndent;
+    };
+    
+    uint qHash( const DocumentPropertiesDiscover::ContentKey& key ) {
+        return uint( key.hash ^ ( key.hash >> 32 ) );
+    }
+    
+    // guess the properties of the buffers handed by readFiles(), possibly from several threads
+    class FilesPropertiesGuesser : public DocumentPropertiesDiscover::FileBufferHandler {
+    public:
+        FilesPropertiesGuesser( const QStringList& _filePaths, bool _detectEol, bool _detectIndent, const QByteArray& _codec )
+            : filePaths( _filePaths ), propertiesList( _filePaths.count() )
+        {
+            detectEol = _detectEol;
+            detectIndent = _detectIndent;
+            codec = _codec;
+            deduplicate = DocumentPropertiesDiscover::contentDeduplicationEnabled();
+            binaryPrefixSize = DocumentPropertiesDiscover::binaryDetectionEnabled() && !DocumentPropertiesDiscover::isWideCodec( codec ) ? DocumentPropertiesDiscover::binaryDetectionPrefixSize() : 0;
+            declaredFiles = 0;
+            // detach now, each thread then only writes its own item
+            properties = propertiesList.data();
+            
+            // files fully declared by .editorconfig are not read
+            for ( int i = 0; i < filePaths.count(); i++ ) {
+                DocumentPropertiesDiscover::FilesPropertiesGuesser::PendingFile file;
+                file.index = i;
+                file.detectEol = detectEol;
+                file.detectIndent = detectIndent;
+                file.declared = DocumentPropertiesDiscover::declaredProperties( filePaths[ i ], file.detectEol, file.detectIndent );
+                
+                if ( !file.declared.isEmpty() && !file.detectEol && !file.detectIndent ) {
+                    properties[ i ] = file.declared.merged( DocumentPropertiesDiscover::GuessedProperties() );
+                    declaredFiles++;
+                    continue;
+                }
+                
+                pendingFiles << file;
+                pendingFilePaths << filePaths[ i ];
+            }
+        }
+        
+        // the files to read, handleFileBuffer() index refers to this list
+        QStringList filesToRead() const {
+            return pendingFilePaths;
+        }
+        
+        // binary files are rejected from their first bytes, the rest is never read
+        virtual int prefixSize() const {
+            return binaryPrefixSize;
+        }
+        
+        virtual bool acceptPrefix( int index, const QByteArray& prefix ) {
+            Q_UNUSED( index );
+            return !DocumentPropertiesDiscover::isBinaryData( prefix );
+        }
+        
+        virtual void handleFileBuffer( int index, DocumentPropertiesDiscover::FileBufferHandler::Status status, const QByteArray& data ) {
+            const DocumentPropertiesDiscover::FilesPropertiesGuesser::PendingFile& file = pendingFiles[ index ];
+            
+            switch ( status ) {
+                case DocumentPropertiesDiscover::FileBufferHandler::Read:
+                    properties[ file.index ] = file.declared.merged( guessData( data, file ) );
+                    break;
+                case DocumentPropertiesDiscover::FileBufferHandler::Rejected:
+                    properties[ file.index ] = DocumentPropertiesDiscover::GuessedProperties::binaryContent;
+                    binaryFiles.ref();
+                    break;
+                case DocumentPropertiesDiscover::FileBufferHandler::TooLarge: {
+                    DocumentPropertiesDiscover::FileOutcome outcome;
+                    properties[ file.index ] = DocumentPropertiesDiscover::guessFile( filePaths[ file.index ], detectEol, detectIndent, codec, 0, outcome );
+                    
+                    if ( outcome == DocumentPropertiesDiscover::BinaryFile ) {
+                        binaryFiles.ref();
+                    }
+                    else if ( outcome == DocumentPropertiesDiscover::FailedFile ) {
+                        failedFiles.ref();
+                    }
+                    break;
+                }
+                case DocumentPropertiesDiscover::FileBufferHandler::Failed:
+                    properties[ file.index ] = file.declared.merged( DocumentPropertiesDiscover::GuessedProperties() );
+                    failedFiles.ref();
+                    break;
+            }
+        }
+        
+        DocumentPropertiesDiscover::GuessedProperties::List results() const {
+            return propertiesList.toList();
+        }
         
-        foreach ( const QString& k, DocumentPropertiesDiscover::lines.keys() ) {
+        DocumentPropertiesDiscover::BatchStatistics statistics() const {
+            DocumentPropertiesDiscover::BatchStatistics statistics;
+            statistics.files = filePaths.count();
+            statistics.declaredFiles = declaredFiles;
+            statistics.duplicateFiles = duplicateFiles;
+            statistics.failedFiles = failedFiles;
+            statistics.binaryFiles = binaryFiles;
+            return statistics;
+        }
+    
+    protected:
+        struct PendingFile {
+            int index;
+            bool detectEol;
+            bool detectIndent;
+            DocumentPropertiesDiscover::EditorConfigProperties declared;
+        };
+        
+        const QStringList filePaths;
+        bool detectEol;
+        bool detectIndent;
+        QByteArray codec;
+        QVector<DocumentPropertiesDiscover::GuessedProperties> propertiesList;
+        DocumentPropertiesDiscover::GuessedProperties* properties;
+        QVector<DocumentPropertiesDiscover::FilesPropertiesGuesser::PendingFile> pendingFiles;
+        QStringList pendingFilePaths;
+        bool deduplicate;
+        int binaryPrefixSize;
+        QMutex mutex;
+        QWaitCondition guessed;
+        QHash<DocumentPropertiesDiscover::ContentKey, DocumentPropertiesDiscover::GuessedProperties> contents;
+        QSet<DocumentPropertiesDiscover::ContentKey> guessing;
+        int declaredFiles;
+        QAtomicInt duplicateFiles;
+        QAtomicInt failedFiles;
+        QAtomicInt binaryFiles;
+        
+        // identical contents are guessed once, the hash is computed while the buffer is still hot from the read
+        DocumentPropertiesDiscover::GuessedProperties guessData( const QByteArray& data, const DocumentPropertiesDiscover::FilesPropertiesGuesser::PendingFile& file ) {
+            if ( !deduplicate ) {
+                return DocumentPropertiesDiscover::guessTextData( data, file.detectEol, file.detectIndent, codec, 0 );
+            }
+            
+            DocumentPropertiesDiscover::ContentKey key;
+            key.hash = DocumentPropertiesDiscover::contentHash( data );
+            key.size = data.size();
+            key.detectEol = file.detectEol;
+            key.detectIndent = file.detectIndent;
+            
+            {
+                QMutexLocker locker( &mutex );
+                
+                forever {
+                    QHash<DocumentPropertiesDiscover::ContentKey, DocumentPropertiesDiscover::GuessedProperties>::const_iterator it = contents.constFind( key );
+                    
+                    if ( it != contents.constEnd() ) {
+                        duplicateFiles.ref();
+                        return it.value();
+                    }
+                    
+                    if ( !guessing.contains( key ) ) {
+                        break;
+                    }
+                    
+                    // another thread is guessing the same content
+                    guessed.wait( &mutex );
+                }
+                
+                guessing << key;
+            }
+            
+            const DocumentPropertiesDiscover::GuessedProperties properties = DocumentPropertiesDiscover::guessTextData( data, file.detectEol, file.detectIndent, codec, 0 );
+            
+            QMutexLocker locker( &mutex );
+            guessing.remove( key );
+            contents[ key ] = properties;
+            guessed.wakeAll();
+            return properties;
+        }
+    };
+    
+    // shared state of a streamed batch
+    struct StreamedBatch {
+        StreamedBatch( int maximumInFlight )
+            : window( maximumInFlight )
+        {
+            sink = 0;
+            detectEol = false;
+            detectIndent = false;
+        }
+        
+        // hand a result to the sink and free its window slot
+        void deliver( qint64 index, const QString& filePath, const DocumentPropertiesDiscover::GuessedProperties& properties, DocumentPropertiesDiscover::FileOutcome outcome ) {
+            {
+                QMutexLocker locker( &mutex );
+                
+                switch ( outcome ) {
+                    case DocumentPropertiesDiscover::GuessedFile:
+                        break;
+                    case DocumentPropertiesDiscover::DeclaredFile:
+                        statistics.declaredFiles++;
+                        break;
+                    case DocumentPropertiesDiscover::FailedFile:
+                        statistics.failedFiles++;
+                        break;
+                    case DocumentPropertiesDiscover::BinaryFile:
+                        statistics.binaryFiles++;
+                        break;
+                }
+                
+                sink->receive( index, filePath, properties );
+            }
+            
+            window.release();
+        }
+        
+        DocumentPropertiesDiscover::PropertiesSink* sink;
+        bool detectEol;
+        bool detectIndent;
+        QByteArray codec;
+        QSemaphore window; // free slots of the in flight window
+        QMutex mutex; // serializes the sink calls and the statistics
+        DocumentPropertiesDiscover::BatchStatistics statistics;
+    };
+    
+    class StreamedFileRunnable : public QRunnable {
+    public:
+        StreamedFileRunnable( DocumentPropertiesDiscover::StreamedBatch* _batch, qint64 _index, const QString& _filePath ) {
+            batch = _batch;
+            index = _index;
+            filePath = _filePath;
+        }
+        
+        virtual void run() {
+            DocumentPropertiesDiscover::FileOutcome outcome;
+            const DocumentPropertiesDiscover::GuessedProperties properties = DocumentPropertiesDiscover::guessFile( filePath, batch->detectEol, batch->detectIndent, batch->codec, 0, outcome );
+            batch->deliver( index, filePath, properties, outcome );
+        }
+    
+    protected:
+        DocumentPropertiesDiscover::StreamedBatch* batch;
+        qint64 index;
+        QString filePath;
+    };
+    
+    qint64 linesMax( const DocumentPropertiesDiscover::ParseContext& context, const QString& key ) {
+        qint64 value = -1;
+        
+        foreach ( const QString& k, context.lines.keys() ) {
             if ( k.startsWith( key ) ) {
                 const int n = k.mid( key.length() ).toInt();
                 
                 if ( n >= 2 && n <= 8 ) {
-                    value = qMax( value, DocumentPropertiesDiscover::lines[ k ] );
+                    value = qMax( value, context.lines[ k ] );
                 }
             }
         }
@@ -79,12 +527,12 @@ namespace DocumentPropertiesDiscover {
         return value;
     }
     
-    int eolMax() {
+    int eolMax( const DocumentPropertiesDiscover::ParseContext& context ) {
         int eol = DocumentPropertiesDiscover::UndefinedEol;
-        int value = -1;
+        qint64 value = -1;
         
-        foreach ( const DocumentPropertiesDiscover::Eol& key, DocumentPropertiesDiscover::eols.keys() ) {
-            const int count = DocumentPropertiesDiscover::eols[ key ];
+        foreach ( const DocumentPropertiesDiscover::Eol& key, context.eols.keys() ) {
+            const qint64 count = context.eols[ key ];
             
             if ( count > value ) {
                 eol = key;
@@ -99,24 +547,10 @@ namespace DocumentPropertiesDiscover {
         return eol;
     }
     
-    void clear() {
-        DocumentPropertiesDiscover::lines.clear();
-        DocumentPropertiesDiscover::eols.clear();
-        
-        DocumentPropertiesDiscover::nb_processed_lines = 0;
-        DocumentPropertiesDiscover::nb_indent_hint = 0;
-        
-        DocumentPropertiesDiscover::indent_re = QRegExp( "^([ \t]+)([^ \t]+)" );
-        DocumentPropertiesDiscover::mixed_re = QRegExp( "^(\t+)( +)$" );
-        
-        DocumentPropertiesDiscover::skip_next_line = false;
-        DocumentPropertiesDiscover::previous_line_info = DocumentPropertiesDiscover::LineInfo();
-    }
-    
-    DocumentPropertiesDiscover::GuessedProperties results() {
-        const int max_line_space = DocumentPropertiesDiscover::linesMax( "space" );
-        const int max_line_mixed = DocumentPropertiesDiscover::linesMax( "mixed" );
-        const int max_line_tab = DocumentPropertiesDiscover::lines[ "tab" ];
+    DocumentPropertiesDiscover::GuessedProperties results( DocumentPropertiesDiscover::ParseContext& context ) {
+        const qint64 max_line_space = DocumentPropertiesDiscover::linesMax( context, "space" );
+        const qint64 max_line_mixed = DocumentPropertiesDiscover::linesMax( context, "mixed" );
+        const qint64 max_line_tab = context.lines[ "tab" ];
 
         /*
         ### Result analysis
@@ -161,80 +595,80 @@ namespace DocumentPropertiesDiscover {
 
         // Detect space indented file
         if ( max_line_space >= max_line_mixed && max_line_space > max_line_tab ) {
-            int nb = 0;
+            qint64 nb = 0;
             int indent_value = -1;
             
             for ( int i = 8; i > 1; --i ) {
                 // give a 10% threshold
-                if ( DocumentPropertiesDiscover::lines[ QString( "space%1" ).arg( i ) ] > int( nb *1.1 ) ) {
+                if ( context.lines[ QString( "space%1" ).arg( i ) ] > qint64( nb *1.1 ) ) {
                     indent_value = i;
-                    nb = DocumentPropertiesDiscover::lines[ QString( "space%1" ).arg( indent_value ) ];
+                    nb = context.lines[ QString( "space%1" ).arg( indent_value ) ];
                 }
             }
 
             // no lines
             if ( indent_value == -1 ) {
-                result = DocumentPropertiesDiscover::defaultGuessedProperties( DocumentPropertiesDiscover::eolMax() );
+                result = DocumentPropertiesDiscover::defaultGuessedProperties( DocumentPropertiesDiscover::eolMax( context ) );
             }
             else {
-                result = DocumentPropertiesDiscover::GuessedProperties( DocumentPropertiesDiscover::eolMax(), DocumentPropertiesDiscover::SpacesIndent, indent_value );
+                result = DocumentPropertiesDiscover::GuessedProperties( DocumentPropertiesDiscover::eolMax( context ), DocumentPropertiesDiscover::SpacesIndent, indent_value );
             }
         }
         // Detect tab files
         else if ( max_line_tab > max_line_mixed && max_line_tab > max_line_space ) {
-            result = DocumentPropertiesDiscover::GuessedProperties( DocumentPropertiesDiscover::eolMax(), DocumentPropertiesDiscover::TabsIndent, DocumentPropertiesDiscover::defaultIndentWidth(), DocumentPropertiesDiscover::defaultTabWidth() );
+            result = DocumentPropertiesDiscover::GuessedProperties( DocumentPropertiesDiscover::eolMax( context ), DocumentPropertiesDiscover::TabsIndent, DocumentPropertiesDiscover::defaultIndentWidth(), DocumentPropertiesDiscover::defaultTabWidth() );
         }
         // Detect mixed files
         else if ( max_line_mixed >= max_line_tab && max_line_mixed > max_line_space ) {
-            int nb = 0;
+            qint64 nb = 0;
             int indent_value = -1;
             
             for ( int i = 8; i > 1; --i ) {
                 // give a 10% threshold
-                if ( DocumentPropertiesDiscover::lines[ QString( "mixed%1" ).arg( i ) ] > int( nb *1.1 ) ) {
+                if ( context.lines[ QString( "mixed%1" ).arg( i ) ] > qint64( nb *1.1 ) ) {
                     indent_value = i;
-                    nb = DocumentPropertiesDiscover::lines[ QString( "mixed%1" ).arg( indent_value ) ];
+                    nb = context.lines[ QString( "mixed%1" ).arg( indent_value ) ];
                 }
             }
 
             // no lines
             if ( indent_value == -1 ) {
-                result = DocumentPropertiesDiscover::defaultGuessedProperties( DocumentPropertiesDiscover::eolMax() );
+                result = DocumentPropertiesDiscover::defaultGuessedProperties( DocumentPropertiesDiscover::eolMax( context ) );
             }
             else {
-                result = DocumentPropertiesDiscover::GuessedProperties( DocumentPropertiesDiscover::eolMax(), DocumentPropertiesDiscover::MixedIndent, indent_value, 8 );
+                result = DocumentPropertiesDiscover::GuessedProperties( DocumentPropertiesDiscover::eolMax( context ), DocumentPropertiesDiscover::MixedIndent, indent_value, 8 );
             }
         }
         // not enough information to make a decision
         else {
-            result = DocumentPropertiesDiscover::defaultGuessedProperties( DocumentPropertiesDiscover::eolMax() );
+            result = DocumentPropertiesDiscover::defaultGuessedProperties( DocumentPropertiesDiscover::eolMax( context ) );
         }
 
 #if PRINT_OUTPUT
-        qWarning( "Nb of scanned lines : %d", DocumentPropertiesDiscover::nb_processed_lines );
-        qWarning( "Nb of indent hint : %d", DocumentPropertiesDiscover::nb_indent_hint );
+        qWarning( "Nb of scanned lines : %lld", context.nb_processed_lines );
+        qWarning( "Nb of indent hint : %lld", context.nb_indent_hint );
         qWarning( "Collected data:" );
         
-        foreach( const QString& key, DocumentPropertiesDiscover::lines.keys() ) {
-            if ( DocumentPropertiesDiscover::lines[ key ] > 0 ) {
-                qWarning( "%s: %d", qPrintable( key ), DocumentPropertiesDiscover::lines[ key ] );
+        foreach( const QString& key, context.lines.keys() ) {
+            if ( context.lines[ key ] > 0 ) {
+                qWarning( "%s: %lld", qPrintable( key ), context.lines[ key ] );
             }
         }
         
-        qWarning( "unix_eol: %d", DocumentPropertiesDiscover::eols[ DocumentPropertiesDiscover::UnixEol ] );
-        qWarning( "dos_eol: %d", DocumentPropertiesDiscover::eols[ DocumentPropertiesDiscover::DOSEol ] );
-        qWarning( "macos_eol: %d", DocumentPropertiesDiscover::eols[ DocumentPropertiesDiscover::MacOSEol ] );
+        qWarning( "unix_eol: %lld", context.eols[ DocumentPropertiesDiscover::UnixEol ] );
+        qWarning( "dos_eol: %lld", context.eols[ DocumentPropertiesDiscover::DOSEol ] );
+        qWarning( "macos_eol: %lld", context.eols[ DocumentPropertiesDiscover::MacOSEol ] );
         
-        qWarning( "max_line_space: %d", max_line_space );
-        qWarning( "max_line_mixed: %d", max_line_mixed );
-        qWarning( "max_line_tab: %d", max_line_tab );
+        qWarning( "max_line_space: %lld", max_line_space );
+        qWarning( "max_line_mixed: %lld", max_line_mixed );
+        qWarning( "max_line_tab: %lld", max_line_tab );
         
         qWarning( "Result: %s", qPrintable( result.toString() ) );
 #endif
         return result;
     }
     
-    DocumentPropertiesDiscover::LineInfo analyzeLineType( const QString& line ) {
+    DocumentPropertiesDiscover::LineInfo analyzeLineType( DocumentPropertiesDiscover::ParseContext& context, const QString& line ) {
         /*
         Analyse the type of line and return (LineType, <indentation part of the line>).
 
@@ -250,12 +684,12 @@ namespace DocumentPropertiesDiscover {
             return DocumentPropertiesDiscover::LineInfo( DocumentPropertiesDiscover::NoIndent, QString::null );
         }
         
-        if ( DocumentPropertiesDiscover::indent_re.indexIn( line ) == -1 ) {
+        if ( context.indent_re.indexIn( line ) == -1 ) {
             return DocumentPropertiesDiscover::LineInfo();
         }
         
-        const QString indent_part = DocumentPropertiesDiscover::indent_re.cap( 1 );
-        const QString text_part = DocumentPropertiesDiscover::indent_re.cap( 2 );
+        const QString indent_part = context.indent_re.cap( 1 );
+        const QString text_part = context.indent_re.cap( 2 );
 
         // continuation of a C/C++ comment, unlikely to be indented correctly
         if ( text_part.startsWith( "*" ) ) {
@@ -270,13 +704,13 @@ namespace DocumentPropertiesDiscover {
         // mixed mode
         if ( indent_part.contains( "\t" ) && indent_part.contains( " " ) ) {
             // line is not composed of '\t\t\t    ', ignore it
-            if ( !DocumentPropertiesDiscover::mixed_re.exactMatch( indent_part ) ) {
+            if ( !context.mixed_re.exactMatch( indent_part ) ) {
                 return DocumentPropertiesDiscover::LineInfo();
             }
             
             mixed_mode = true;
-            tab_part = DocumentPropertiesDiscover::mixed_re.cap( 1 );
-            space_part = DocumentPropertiesDiscover::mixed_re.cap( 2 );
+            tab_part = context.mixed_re.cap( 1 );
+            space_part = context.mixed_re.cap( 2 );
         }
         
         if ( mixed_mode ) {
@@ -307,10 +741,10 @@ namespace DocumentPropertiesDiscover {
         return DocumentPropertiesDiscover::LineInfo();
     }
     
-    QString analyzeLineIndentation( const QString& line ) {
-        const DocumentPropertiesDiscover::LineInfo previous_line_info = DocumentPropertiesDiscover::previous_line_info;
-        const DocumentPropertiesDiscover::LineInfo current_line_info = DocumentPropertiesDiscover::analyzeLineType( line );
-        DocumentPropertiesDiscover::previous_line_info = current_line_info;
+    QString analyzeLineIndentation( DocumentPropertiesDiscover::ParseContext& context, const QString& line ) {
+        const DocumentPropertiesDiscover::LineInfo previous_line_info = context.previous_line_info;
+        const DocumentPropertiesDiscover::LineInfo current_line_info = DocumentPropertiesDiscover::analyzeLineType( context, line );
+        context.previous_line_info = current_line_info;
 
         if ( current_line_info == DocumentPropertiesDiscover::LineInfo() || previous_line_info == DocumentPropertiesDiscover::LineInfo() ) {
             return QString::null;
@@ -321,7 +755,7 @@ namespace DocumentPropertiesDiscover {
         if ( t == qMakePair( DocumentPropertiesDiscover::TabOnly, DocumentPropertiesDiscover::TabOnly ) ||
             t == qMakePair( DocumentPropertiesDiscover::NoIndent, DocumentPropertiesDiscover::TabOnly ) ) {
             if ( current_line_info.second.length() -previous_line_info.second.length() == 1 ) {
-                DocumentPropertiesDiscover::lines[ "tab" ]++;
+                context.lines[ "tab" ]++;
                 return "tab";
             }
         }
@@ -332,7 +766,7 @@ namespace DocumentPropertiesDiscover {
             
             if ( 1 < nb_space && nb_space < 8 ) {
                 QString key = QString( "space%1" ).arg( nb_space );
-                DocumentPropertiesDiscover::lines[ key ]++;
+                context.lines[ key ]++;
                 return key;
             }
         }
@@ -343,8 +777,8 @@ namespace DocumentPropertiesDiscover {
             if ( 1 < nb_space && nb_space < 8 ) {
                 QString key1 = QString( "space%1" ).arg( nb_space );
                 QString key2 = QString( "mixed%1" ).arg( nb_space );
-                DocumentPropertiesDiscover::lines[ key1 ]++;
-                DocumentPropertiesDiscover::lines[ key2 ]++;
+                context.lines[ key1 ]++;
+                context.lines[ key2 ]++;
                 return key1;
             }
         }
@@ -356,7 +790,7 @@ namespace DocumentPropertiesDiscover {
                 
                 if ( 1 < nb_space && nb_space < 8 ) {
                     QString key = QString( "mixed%1" ).arg( nb_space );
-                    DocumentPropertiesDiscover::lines[ key ]++;
+                    context.lines[ key ]++;
                     return key;
                 }
             }
@@ -367,7 +801,7 @@ namespace DocumentPropertiesDiscover {
                 
                 if ( 1 < nb_space && nb_space < 8 ) {
                     QString key = QString( "mixed%1" ).arg( nb_space );
-                    DocumentPropertiesDiscover::lines[ key ]++;
+                    context.lines[ key ]++;
                     return key;
                 }
             }
@@ -378,7 +812,7 @@ namespace DocumentPropertiesDiscover {
                 
                 if ( 1 < nb_space && nb_space < 8 ) {
                     QString key = QString( "mixed%1" ).arg( nb_space );
-                    DocumentPropertiesDiscover::lines[ key ]++;
+                    context.lines[ key ]++;
                     return key;
                 }
             }
@@ -387,29 +821,48 @@ namespace DocumentPropertiesDiscover {
         return QString::null;
     }
     
-    QString analyzeLine( const QString& line ) {
-        DocumentPropertiesDiscover::nb_processed_lines++;
-        const bool skip_current_line = DocumentPropertiesDiscover::skip_next_line;
-        DocumentPropertiesDiscover::skip_next_line = false;
+    QString analyzeLine( DocumentPropertiesDiscover::ParseContext& context, const QString& line ) {
+        context.nb_processed_lines++;
+        const bool skip_current_line = context.skip_next_line;
+        context.skip_next_line = false;
         
         // skip lines after lines ending in '\'
         if ( line.endsWith( '\\' ) ) {
-            DocumentPropertiesDiscover::skip_next_line = true;
+            context.skip_next_line = true;
         }
         
         if ( skip_current_line ) {
             return QString::null;
         }
         
-        const QString key = DocumentPropertiesDiscover::analyzeLineIndentation( line );
+        const QString key = DocumentPropertiesDiscover::analyzeLineIndentation( context, line );
         
         if ( !key.isEmpty() ) {
-            DocumentPropertiesDiscover::nb_indent_hint++;
+            context.nb_indent_hint++;
         }
         
         return key;
     }
     
+    void fillCounters( const DocumentPropertiesDiscover::ParseContext& context, DocumentPropertiesDiscover::Counters* counters ) {
+        if ( !counters ) {
+            return;
+        }
+        
+        *counters = DocumentPropertiesDiscover::Counters();
+        counters->lines = context.nb_processed_lines;
+        counters->indentHints = context.nb_indent_hint;
+        counters->unixEols = context.eols.value( DocumentPropertiesDiscover::UnixEol );
+        counters->dosEols = context.eols.value( DocumentPropertiesDiscover::DOSEol );
+        counters->macOSEols = context.eols.value( DocumentPropertiesDiscover::MacOSEol );
+        counters->tabs = context.lines.value( "tab" );
+        
+        for ( int i = 2; i <= 8; i++ ) {
+            counters->spaces[ i ] = context.lines.value( QString( "space%1" ).arg( i ) );
+            counters->mixed[ i ] = context.lines.value( QString( "mixed%1" ).arg( i ) );
+        }
+    }
+    
     int eolLength( const DocumentPropertiesDiscover::Eol& eol ) {
         switch ( eol ) {
             case DocumentPropertiesDiscover::UnixEol:
@@ -436,6 +889,43 @@ namespace DocumentPropertiesDiscover {
         }
     }
     
+    QString convertIndentPart( const QString& _indentPart, const DocumentPropertiesDiscover::GuessedProperties& from, const DocumentPropertiesDiscover::GuessedProperties& to ) {
+        QString indentPart = _indentPart;
+        
+        switch ( to.indent ) {
+            case DocumentPropertiesDiscover::UndefinedIndent:
+                Q_ASSERT( 0 );
+                qFatal( "Can't be there!" );
+                break;
+            case DocumentPropertiesDiscover::TabsIndent: {
+                if ( from.tabWidth > to.tabWidth ) {
+                    indentPart.replace( "\t", "\t\t" );
+                }
+                
+                indentPart.replace( QString( to.tabWidth, ' ' ), "\t" );
+                /*const bool hasSpaces = indentPart.contains( " " );
+                
+                if ( hasSpaces ) {
+                    indentPart.remove( " " );
+                    indentPart.append( "\t" );
+                }*/
+                
+                break;
+            }
+            case DocumentPropertiesDiscover::SpacesIndent:
+                indentPart.replace( "\t", QString( to.tabWidth, ' ' ) );
+                break;
+            case DocumentPropertiesDiscover::MixedIndent:
+                // make all space
+                indentPart.replace( "\t", QString( to.tabWidth, ' ' ) );
+                // replace first with tabs
+                indentPart.replace( QString( to.tabWidth, ' ' ), "\t" );
+                break;
+        }
+        
+        return indentPart;
+    }
+    
     int getNextNonWhitespaceOffset( const QString& content, const int& offset ) {
         const int length = content.length();
         int index = -1;
@@ -482,13 +972,14 @@ namespace DocumentPropertiesDiscover {
                 // maybe macos eol or dos eol
                 case '\r':
                     // chars after
-                    if ( i < length -1 -1 ) {
-                        if ( incrementEol ) {
-                            i++;
-                        }
-                        
+                    if ( i < length -1 ) {
                         // dos / mac os eol
                         eol = content[ i +1 ] == '\n' ? DocumentPropertiesDiscover::DOSEol : DocumentPropertiesDiscover::MacOSEol;
+                        
+                        // skip the \n of dos eol
+                        if ( incrementEol && eol == DocumentPropertiesDiscover::DOSEol ) {
+                            i++;
+                        }
                     }
                     // ending char, macos eol
                     else {
@@ -516,7 +1007,7 @@ namespace DocumentPropertiesDiscover {
         return eol;
     }
     
-    void parseContent( const QString& content, bool detectEol, bool detectIndent ) {
+    void parseContent( DocumentPropertiesDiscover::ParseContext& context, const QString& content, bool detectEol, bool detectIndent ) {
         if ( !detectEol && !detectIndent ) {
             return;
         }
@@ -527,19 +1018,128 @@ namespace DocumentPropertiesDiscover {
         
         while( eol != DocumentPropertiesDiscover::UndefinedEol ) {
             if ( detectEol ) {
-                DocumentPropertiesDiscover::eols[ eol ]++;
+                context.eols[ eol ]++;
             }
             
             if ( detectIndent ) {
-                analyzeLine( content.mid( lastOffset, offset -lastOffset -DocumentPropertiesDiscover::eolLength( eol ) ) );
+                DocumentPropertiesDiscover::analyzeLine( context, content.mid( lastOffset, offset -lastOffset -DocumentPropertiesDiscover::eolLength( eol ) ) );
             }
             
             lastOffset = offset;
             eol = DocumentPropertiesDiscover::getNextEolOffset( content, offset, true );
         }
     }
+    
+    // a line read from a stream, only its head is kept so that huge lines don't grow the memory
+    struct StreamedLine {
+        StreamedLine() {
+            truncated = false;
+        }
+        
+        QString text;
+        QChar lastChar;
+        bool truncated;
+    };
+    
+    void parseStreamedLine( DocumentPropertiesDiscover::ParseContext& context, DocumentPropertiesDiscover::StreamedLine& line, DocumentPropertiesDiscover::Eol eol, bool detectEol, bool detectIndent ) {
+        if ( detectEol ) {
+            context.eols[ eol ]++;
+        }
+        
+        if ( detectIndent ) {
+            // the head holds the indentation and the first chars, the last char tells about line continuation
+            if ( line.truncated ) {
+                line.text.append( line.lastChar );
+            }
+            
+            DocumentPropertiesDiscover::analyzeLine( context, line.text );
+        }
+        
+        line.text.clear();
+        line.truncated = false;
+    }
+    
+    void parseDevice( DocumentPropertiesDiscover::ParseContext& context, QIODevice* device, QTextCodec* codec, bool detectEol, bool detectIndent ) {
+        if ( !detectEol && !detectIndent ) {
+            return;
+        }
+        
+        QScopedPointer<QTextDecoder> decoder( codec->makeDecoder() );
+        QByteArray buffer( DocumentPropertiesDiscover::streamChunkSize, '\0' );
+        DocumentPropertiesDiscover::StreamedLine line;
+        bool pendingCr = false;
+        qint64 read = 0;
+        
+        while ( ( read = device->read( buffer.data(), buffer.size() ) ) > 0 ) {
+            const QString chunk = decoder->toUnicode( buffer.constData(), read );
+            const int length = chunk.length();
+            
+            for ( int i = 0; i < length; i++ ) {
+                const QChar& c = chunk[ i ];
+                
+                // a \r may be the last char of the previous chunk
+                if ( pendingCr ) {
+                    pendingCr = false;
+                    
+                    if ( c == '\n' ) {
+                        DocumentPropertiesDiscover::parseStreamedLine( context, line, DocumentPropertiesDiscover::DOSEol, detectEol, detectIndent );
+                        continue;
+                    }
+                    
+                    DocumentPropertiesDiscover::parseStreamedLine( context, line, DocumentPropertiesDiscover::MacOSEol, detectEol, detectIndent );
+                }
+                
+                if ( c == '\r' ) {
+                    pendingCr = true;
+                }
+                else if ( c == '\n' ) {
+                    DocumentPropertiesDiscover::parseStreamedLine( context, line, DocumentPropertiesDiscover::UnixEol, detectEol, detectIndent );
+                }
+                else if ( line.text.length() < DocumentPropertiesDiscover::streamMaximumLineLength ) {
+                    line.text.append( c );
+                }
+                else {
+                    line.truncated = true;
+                    line.lastChar = c;
+                }
+            }
+        }
+        
+        // ending char, macos eol
+        if ( pendingCr ) {
+            DocumentPropertiesDiscover::parseStreamedLine( context, line, DocumentPropertiesDiscover::MacOSEol, detectEol, detectIndent );
+        }
+        
+        // like parseContent(), a last line without eol is not analyzed
+    }
+    
+    DocumentPropertiesDiscover::GuessedProperties guessTextData( const QByteArray& data, bool detectEol, bool detectIndent, const QByteArray& _codec, DocumentPropertiesDiscover::Counters* counters ) {
+        QTextCodec* codec = QTextCodec::codecForName( _codec );
+        
+        if ( !codec ) {
+            codec = QTextCodec::codecForUtfText( data, QTextCodec::codecForLocale() );
+        }
+        
+        return DocumentPropertiesDiscover::guessContentProperties( codec->toUnicode( data ), detectEol, detectIndent, counters );
+    }
+    
+    DocumentPropertiesDiscover::GuessedProperties guessTextDevice( QIODevice* device, bool detectEol, bool detectIndent, const QByteArray& _codec, DocumentPropertiesDiscover::Counters* counters ) {
+        QTextCodec* codec = QTextCodec::codecForName( _codec );
+        
+        if ( !codec ) {
+            codec = QTextCodec::codecForUtfText( device->peek( 4 ), QTextCodec::codecForLocale() );
+        }
+        
+        DocumentPropertiesDiscover::ParseContext context;
+        DocumentPropertiesDiscover::parseDevice( context, device, codec, detectEol, detectIndent );
+        const DocumentPropertiesDiscover::GuessedProperties properties = DocumentPropertiesDiscover::results( context );
+        DocumentPropertiesDiscover::fillCounters( context, counters );
+        return properties;
+    }
 }
 
+DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::GuessedProperties::binaryContent = DocumentPropertiesDiscover::binaryGuessedProperties();
+
 // GuessedProperties
 
 DocumentPropertiesDiscover::GuessedProperties::GuessedProperties()
@@ -548,6 +1148,7 @@ DocumentPropertiesDiscover::GuessedProperties::GuessedProperties()
     indent = DocumentPropertiesDiscover::defaultIndent();
     indentWidth = DocumentPropertiesDiscover::defaultIndentWidth();
     tabWidth = DocumentPropertiesDiscover::defaultTabWidth();
+    binary = false;
 }
 
 DocumentPropertiesDiscover::GuessedProperties::GuessedProperties( int _eol, int _indent, int _indentWidth )
@@ -556,6 +1157,7 @@ DocumentPropertiesDiscover::GuessedProperties::GuessedProperties( int _eol, int
     indent = _indent;
     indentWidth = _indentWidth;
     tabWidth = DocumentPropertiesDiscover::defaultTabWidth();
+    binary = false;
 }
 
 DocumentPropertiesDiscover::GuessedProperties::GuessedProperties( int _eol, int _indent, int _indentWidth, int _tabWidth )
@@ -564,6 +1166,7 @@ DocumentPropertiesDiscover::GuessedProperties::GuessedProperties( int _eol, int
     indent = _indent;
     indentWidth = _indentWidth;
     tabWidth = _tabWidth;
+    binary = false;
 }
 
 bool DocumentPropertiesDiscover::GuessedProperties::operator==( const DocumentPropertiesDiscover::GuessedProperties& other ) const
@@ -572,7 +1175,8 @@ bool DocumentPropertiesDiscover::GuessedProperties::operator==( const DocumentPr
         eol == other.eol &&
         indent == other.indent &&
         indentWidth == other.indentWidth &&
-        tabWidth == other.tabWidth
+        tabWidth == other.tabWidth &&
+        binary == other.binary
     ;
 }
 
@@ -582,6 +1186,10 @@ bool DocumentPropertiesDiscover::GuessedProperties::operator!=( const DocumentPr
 }
 
 QString DocumentPropertiesDiscover::GuessedProperties::toString() const {
+    if ( binary ) {
+        return QString( "Binary" );
+    }
+    
     switch ( indent ) {
         case DocumentPropertiesDiscover::SpacesIndent:
             return QString( "Spaces: tab %1 space %2 - Eol: %3" ).arg( tabWidth ).arg( indentWidth ).arg( eol );
@@ -595,6 +1203,43 @@ QString DocumentPropertiesDiscover::GuessedProperties::toString() const {
     }
 }
 
+// Counters
+
+DocumentPropertiesDiscover::Counters::Counters()
+{
+    lines = 0;
+    indentHints = 0;
+    unixEols = 0;
+    dosEols = 0;
+    macOSEols = 0;
+    tabs = 0;
+    
+    for ( int i = 0; i < 9; i++ ) {
+        spaces[ i ] = 0;
+        mixed[ i ] = 0;
+    }
+}
+
+// BatchStatistics
+
+DocumentPropertiesDiscover::BatchStatistics::BatchStatistics()
+{
+    files = 0;
+    declaredFiles = 0;
+    duplicateFiles = 0;
+    failedFiles = 0;
+    binaryFiles = 0;
+}
+
+// Edit
+
+DocumentPropertiesDiscover::Edit::Edit( int _offset, int _length, const QString& _replacement )
+{
+    offset = _offset;
+    length = _length;
+    replacement = _replacement;
+}
+
 // DocumentPropertiesDiscover
 
 DocumentPropertiesDiscover::Eol DocumentPropertiesDiscover::defaultEol()
@@ -637,57 +1282,204 @@ void DocumentPropertiesDiscover::setDefaultTabWidth( int tabWidth )
     DocumentPropertiesDiscover::_defaultTabWidth = tabWidth;
 }
 
-DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::guessContentProperties( const QString& content, bool detectEol, bool detectIndent )
+qint64 DocumentPropertiesDiscover::largeFileThreshold()
+{
+    return DocumentPropertiesDiscover::_largeFileThreshold;
+}
+
+void DocumentPropertiesDiscover::setLargeFileThreshold( qint64 size )
+{
+    DocumentPropertiesDiscover::_largeFileThreshold = qMin( size, DocumentPropertiesDiscover::maximumLargeFileThreshold );
+}
+
+bool DocumentPropertiesDiscover::contentDeduplicationEnabled()
 {
-    DocumentPropertiesDiscover::clear();
-    DocumentPropertiesDiscover::parseContent( content, detectEol, detectIndent );
-    const DocumentPropertiesDiscover::GuessedProperties properties = DocumentPropertiesDiscover::results();
+    return DocumentPropertiesDiscover::_contentDeduplicationEnabled;
+}
+
+void DocumentPropertiesDiscover::setContentDeduplicationEnabled( bool enabled )
+{
+    DocumentPropertiesDiscover::_contentDeduplicationEnabled = enabled;
+}
+
+bool DocumentPropertiesDiscover::binaryDetectionEnabled()
+{
+    return DocumentPropertiesDiscover::_binaryDetectionEnabled;
+}
+
+void DocumentPropertiesDiscover::setBinaryDetectionEnabled( bool enabled )
+{
+    DocumentPropertiesDiscover::_binaryDetectionEnabled = enabled;
+}
+
+int DocumentPropertiesDiscover::binaryDetectionPrefixSize()
+{
+    return DocumentPropertiesDiscover::_binaryDetectionPrefixSize;
+}
+
+void DocumentPropertiesDiscover::setBinaryDetectionPrefixSize( int size )
+{
+    DocumentPropertiesDiscover::_binaryDetectionPrefixSize = size;
+}
+
+bool DocumentPropertiesDiscover::isBinaryData( const QByteArray& data )
+{
+    const uchar* bytes = reinterpret_cast<const uchar*>( data.constData() );
+    const int size = qMin( data.size(), DocumentPropertiesDiscover::binaryDetectionPrefixSize() );
+    
+    if ( size <= 0 ) {
+        return false;
+    }
+    
+    // unicode byte order marks, wide texts have NUL bytes
+    if ( size >= 2 && ( ( bytes[ 0 ] == 0xff && bytes[ 1 ] == 0xfe ) || ( bytes[ 0 ] == 0xfe && bytes[ 1 ] == 0xff ) ) ) {
+        return false;
+    }
+    
+    if ( size >= 4 && bytes[ 0 ] == 0x00 && bytes[ 1 ] == 0x00 && bytes[ 2 ] == 0xfe && bytes[ 3 ] == 0xff ) {
+        return false;
+    }
+    
+    for ( uint i = 0; i < sizeof( DocumentPropertiesDiscover::magicNumbers ) /sizeof( DocumentPropertiesDiscover::magicNumbers[ 0 ] ); i++ ) {
+        const DocumentPropertiesDiscover::MagicNumber& magic = DocumentPropertiesDiscover::magicNumbers[ i ];
+        
+        if ( size >= magic.size && memcmp( bytes, magic.bytes, magic.size ) == 0 ) {
+            return true;
+        }
+    }
+    
+    int controls = 0;
+    
+    for ( int i = 0; i < size; i++ ) {
+        const uchar c = bytes[ i ];
+        
+        if ( c == 0x00 ) {
+            return true;
+        }
+        
+        // tab, eols, form feed, backspace and escape sequences are common in texts
+        if ( ( c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != '\v' && c != '\b' && c != 0x1b ) || c == 0x7f ) {
+            controls++;
+        }
+    }
+    
+    // more than 10% of control chars
+    return controls *10 > size;
+}
+
+bool DocumentPropertiesDiscover::editorConfigEnabled()
+{
+    return DocumentPropertiesDiscover::_editorConfigEnabled;
+}
+
+void DocumentPropertiesDiscover::setEditorConfigEnabled( bool enabled )
+{
+    DocumentPropertiesDiscover::_editorConfigEnabled = enabled;
+}
+
+DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::guessContentProperties( const QString& content, bool detectEol, bool detectIndent, DocumentPropertiesDiscover::Counters* counters )
+{
+    DocumentPropertiesDiscover::ParseContext context;
+    DocumentPropertiesDiscover::parseContent( context, content, detectEol, detectIndent );
+    const DocumentPropertiesDiscover::GuessedProperties properties = DocumentPropertiesDiscover::results( context );
+    DocumentPropertiesDiscover::fillCounters( context, counters );
     return properties;
 }
 
-DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::guessFileProperties( const QString& filePath, bool detectEol, bool detectIndent, const QByteArray& _codec )
+DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::guessFileProperties( const QString& filePath, bool detectEol, bool detectIndent, const QByteArray& codec, DocumentPropertiesDiscover::Counters* counters )
+{
+    DocumentPropertiesDiscover::FileOutcome outcome;
+    return DocumentPropertiesDiscover::guessFile( filePath, detectEol, detectIndent, codec, counters, outcome );
+}
+
+DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::guessDataProperties( const QByteArray& data, bool detectEol, bool detectIndent, const QByteArray& codec, DocumentPropertiesDiscover::Counters* counters )
 {
-    QFile file( filePath );
+    if ( DocumentPropertiesDiscover::isBinaryContent( data, codec ) ) {
+        return DocumentPropertiesDiscover::GuessedProperties::binaryContent;
+    }
     
-    if ( !file.exists() || !file.open( QIODevice::ReadOnly ) ) {
+    return DocumentPropertiesDiscover::guessTextData( data, detectEol, detectIndent, codec, counters );
+}
+
+DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::guessDeviceProperties( QIODevice* device, bool detectEol, bool detectIndent, const QByteArray& codec, DocumentPropertiesDiscover::Counters* counters )
+{
+    if ( !device || !device->isReadable() ) {
         return DocumentPropertiesDiscover::GuessedProperties();
     }
     
-    const QByteArray data = file.readAll();
-    QTextCodec* codec = QTextCodec::codecForName( _codec );
+    if ( DocumentPropertiesDiscover::isBinaryContent( device->peek( DocumentPropertiesDiscover::binaryDetectionPrefixSize() ), codec ) ) {
+        return DocumentPropertiesDiscover::GuessedProperties::binaryContent;
+    }
+    
+    return DocumentPropertiesDiscover::guessTextDevice( device, detectEol, detectIndent, codec, counters );
+}
+
+DocumentPropertiesDiscover::GuessedProperties::List DocumentPropertiesDiscover::guessFilesProperties( const QStringList& filePaths, bool detectEol, bool detectIndent, const QByteArray& codec, DocumentPropertiesDiscover::BatchStatistics* statistics )
+{
+    // files are read in batch and parsed concurrently, results are kept in the filePaths order
+    DocumentPropertiesDiscover::FilesPropertiesGuesser guesser( filePaths, detectEol, detectIndent, codec );
+    DocumentPropertiesDiscover::readFiles( guesser.filesToRead(), &guesser, DocumentPropertiesDiscover::largeFileThreshold() );
     
-    if ( !codec ) {
-        codec = QTextCodec::codecForUtfText( data, QTextCodec::codecForLocale() );
+    if ( statistics ) {
+        *statistics = guesser.statistics();
     }
     
-    return DocumentPropertiesDiscover::guessContentProperties( codec->toUnicode( data ), detectEol, detectIndent );
+    return guesser.results();
 }
 
-DocumentPropertiesDiscover::GuessedProperties::List DocumentPropertiesDiscover::guessFilesProperties( const QStringList& filePaths, bool detectEol, bool detectIndent, const QByteArray& codec )
+void DocumentPropertiesDiscover::guessFilesProperties( DocumentPropertiesDiscover::FilePathSource* source, DocumentPropertiesDiscover::PropertiesSink* sink, bool detectEol, bool detectIndent, const QByteArray& codec, int maximumInFlight, DocumentPropertiesDiscover::BatchStatistics* statistics )
 {
-    DocumentPropertiesDiscover::GuessedProperties::List propertiesList;
+    if ( !source || !sink ) {
+        return;
+    }
+    
+    DocumentPropertiesDiscover::StreamedBatch batch( qMax( 1, maximumInFlight ) );
+    batch.sink = sink;
+    batch.detectEol = detectEol;
+    batch.detectIndent = detectIndent;
+    batch.codec = codec;
+    
+    // reads are blocking, use more threads than cores but never more than the window
+    QThreadPool pool;
+    pool.setMaxThreadCount( qMax( 1, qMin( maximumInFlight, QThread::idealThreadCount() *4 ) ) );
     
-    foreach ( const QString& filePath, filePaths ) {
-        propertiesList << DocumentPropertiesDiscover::guessFileProperties( filePath, detectEol, detectIndent, codec );
+    qint64 index = 0;
+    QString filePath;
+    
+    forever {
+        // backpressure, wait for a result to be received before pulling a new file
+        batch.window.acquire();
+        
+        if ( !source->next( filePath ) ) {
+            batch.window.release();
+            break;
+        }
+        
+        pool.start( new DocumentPropertiesDiscover::StreamedFileRunnable( &batch, index, filePath ) );
+        index++;
     }
     
-    return propertiesList;
+    pool.waitForDone();
+    
+    if ( statistics ) {
+        *statistics = batch.statistics;
+        statistics->files = int( qMin( index, qint64( INT_MAX ) ) );
+    }
 }
 
-void DocumentPropertiesDiscover::convertContent( QString& content, const DocumentPropertiesDiscover::GuessedProperties& from, const DocumentPropertiesDiscover::GuessedProperties& to, bool convertEol, bool convertIndent )
+DocumentPropertiesDiscover::Edit::List DocumentPropertiesDiscover::contentEdits( const QString& content, const DocumentPropertiesDiscover::GuessedProperties& from, const DocumentPropertiesDiscover::GuessedProperties& to, bool convertEol, bool convertIndent )
 {
+    DocumentPropertiesDiscover::Edit::List edits;
+    
     if ( content.isEmpty() ) {
-        return;
+        return edits;
     }
     
     if ( !convertEol && !convertIndent ) {
-        return;
+        return edits;
     }
     
-    /*if ( from == to ) {
-        return;
-    }*/
-    
+    // offsets are the ones of the unmodified content, edits are sorted and never overlap
     const QString neededEol = DocumentPropertiesDiscover::eolString( DocumentPropertiesDiscover::Eol( to.eol ) );
     int eolLength;
     int indentOffset = 0;
@@ -698,54 +1490,16 @@ void DocumentPropertiesDiscover::convertContent( QString& content, const Documen
     while( eol != DocumentPropertiesDiscover::UndefinedEol ) {
         eolLength = DocumentPropertiesDiscover::eolLength( eol );
         
-        if ( convertEol ) {
-            if ( eol != to.eol ) {
-                content.replace( offset, eolLength, neededEol );
-                eolLength = neededEol.length();
-            }
-        }
-        
         if ( convertIndent ) {
             indentOffset = qMin( DocumentPropertiesDiscover::getNextNonWhitespaceOffset( content, lastOffset ), offset -1 );
             
             if ( lastOffset < indentOffset && indentOffset < offset ) {
-                QString indentPart = content.mid( lastOffset, indentOffset -lastOffset );
+                const QString indentPart = content.mid( lastOffset, indentOffset -lastOffset );
+                const QString neededIndentPart = DocumentPropertiesDiscover::convertIndentPart( indentPart, from, to );
                 
-                switch ( to.indent ) {
-                    case DocumentPropertiesDiscover::UndefinedIndent:
-                        Q_ASSERT( 0 );
-                        qFatal( "Can't be there!" );
-                        return;
-                    case DocumentPropertiesDiscover::TabsIndent: {
-                        if ( from.tabWidth > to.tabWidth ) {
-                            indentPart.replace( "\t", "\t\t" );
-                        }
-                        
-                        indentPart.replace( QString( to.tabWidth, ' ' ), "\t" );
-                        /*const bool hasSpaces = indentPart.contains( " " );
-                        
-                        if ( hasSpaces ) {
-                            indentPart.remove( " " );
-                            indentPart.append( "\t" );
-                        }*/
-                        
-                        break;
-                    }
-                    case DocumentPropertiesDiscover::SpacesIndent:
-                        indentPart.replace( "\t", QString( to.tabWidth, ' ' ) );
-                        break;
-                    case DocumentPropertiesDiscover::MixedIndent:
-                        // make all space
-                        indentPart.replace( "\t", QString( to.tabWidth, ' ' ) );
-                        // replace first with tabs
-                        indentPart.replace( QString( to.tabWidth, ' ' ), "\t" );
-                        break;
+                if ( neededIndentPart != indentPart ) {
+                    edits << DocumentPropertiesDiscover::Edit( lastOffset, indentPart.length(), neededIndentPart );
                 }
-                
-                // update indent string
-                content.replace( lastOffset, indentOffset -lastOffset, indentPart );
-                // update offset
-                offset = offset -( indentOffset -lastOffset ) +indentPart.length();
             }
             else {
                 //qWarning() << "skip line with no indent";
@@ -754,7 +1508,48 @@ void DocumentPropertiesDiscover::convertContent( QString& content, const Documen
             lastOffset = offset +eolLength;
         }
         
+        if ( convertEol ) {
+            if ( eol != to.eol ) {
+                edits << DocumentPropertiesDiscover::Edit( offset, eolLength, neededEol );
+            }
+        }
+        
         offset += eolLength;
         eol = DocumentPropertiesDiscover::getNextEolOffset( content, offset, false );
     }
+    
+    return edits;
+}
+
+void DocumentPropertiesDiscover::applyEdits( QString& content, const DocumentPropertiesDiscover::Edit::List& edits )
+{
+    if ( edits.isEmpty() ) {
+        return;
+    }
+    
+    int length = content.length();
+    
+    foreach ( const DocumentPropertiesDiscover::Edit& edit, edits ) {
+        length += edit.replacement.length() -edit.length;
+    }
+    
+    // copy the unchanged parts between the edits in one pass
+    QString result;
+    int offset = 0;
+    
+    result.reserve( length );
+    
+    foreach ( const DocumentPropertiesDiscover::Edit& edit, edits ) {
+        result.append( content.midRef( offset, edit.offset -offset ) );
+        result.append( edit.replacement );
+        offset = edit.offset +edit.length;
+    }
+    
+    result.append( content.midRef( offset ) );
+    content = result;
+}
+
+void DocumentPropertiesDiscover::convertContent( QString& content, const DocumentPropertiesDiscover::GuessedProperties& from, const DocumentPropertiesDiscover::GuessedProperties& to, bool convertEol, bool convertIndent )
+{
+    DocumentPropertiesDiscover::applyEdits( content, DocumentPropertiesDiscover::contentEdits( content, from, to, convertEol, convertIndent ) );
 }
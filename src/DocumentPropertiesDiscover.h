@@ -3,10 +3,18 @@
 
 #include <QByteArray>
 #include <QStringList>
-#include <QTime>
-#include <QDebug>
+#include <QMetaType>
+
+#if defined( DPD_STATIC )
+#define DOCUMENTPROPERTIESDISCOVER_EXPORT
+#elif defined( DPD_BUILD_LIBRARY )
+#define DOCUMENTPROPERTIESDISCOVER_EXPORT Q_DECL_EXPORT
+#else
+#define DOCUMENTPROPERTIESDISCOVER_EXPORT Q_DECL_IMPORT
+#endif
 
 class QString;
+class QIODevice;
 
 namespace DocumentPropertiesDiscover
 {
@@ -24,7 +32,7 @@ namespace DocumentPropertiesDiscover
         MixedIndent = TabsIndent | SpacesIndent
     };
     
-    struct GuessedProperties {
+    struct DOCUMENTPROPERTIESDISCOVER_EXPORT GuessedProperties {
         typedef QList<DocumentPropertiesDiscover::GuessedProperties> List;
         
         GuessedProperties();
@@ -37,50 +45,121 @@ namespace DocumentPropertiesDiscover
         QString toString() const;
         
         static DocumentPropertiesDiscover::GuessedProperties null;
+        static DocumentPropertiesDiscover::GuessedProperties binaryContent; // result of contents rejected as binary
         
         int eol; // Eol flags
         int indent; // Indent flags
         int indentWidth; // indent size in spaces
         int tabWidth; // tab size in spaces
+        bool binary; // the content is binary, other members are undefined
     };
     
-    class TimeTracker : public QTime {
-    public:
-        TimeTracker( const QString& _name = QString::null ) {
-            name = _name;
-            start();
-            query( "ctor" );
-        }
+    // raw counters collected while parsing a content
+    struct DOCUMENTPROPERTIESDISCOVER_EXPORT Counters {
+        Counters();
+        
+        qint64 lines; // processed lines
+        qint64 indentHints; // lines giving an indentation hint
+        qint64 unixEols;
+        qint64 dosEols;
+        qint64 macOSEols;
+        qint64 tabs; // lines indented by one more tab than the previous one
+        qint64 spaces[ 9 ]; // lines indented by n ( 2 to 8 ) more spaces than the previous one
+        qint64 mixed[ 9 ]; // lines indented by n ( 2 to 8 ) more mixed spaces than the previous one
+    };
+    
+    struct DOCUMENTPROPERTIESDISCOVER_EXPORT BatchStatistics {
+        BatchStatistics();
         
-        ~TimeTracker() {
-            query( "dtor" );
-        }
+        int files; // files in the batch
+        int declaredFiles; // files fully declared by .editorconfig, not read
+        int duplicateFiles; // files whose content was already guessed in the batch
+        int failedFiles; // files that can't be read
+        int binaryFiles; // files rejected as binary, not decoded
+    };
+    
+    // replace length chars at offset by replacement
+    struct DOCUMENTPROPERTIESDISCOVER_EXPORT Edit {
+        typedef QList<DocumentPropertiesDiscover::Edit> List;
+        
+        Edit( int offset = -1, int length = 0, const QString& replacement = QString::null );
+        
+        int offset; // offset in the original content
+        int length; // replaced chars count
+        QString replacement; // new text
+    };
+    
+    // input of a streamed batch
+    class DOCUMENTPROPERTIESDISCOVER_EXPORT FilePathSource {
+    public:
+        virtual ~FilePathSource() {}
         
-        void query( const QString& text = QString::null ) const {
-            qWarning() << qPrintable( name ) << "Elapsed time:" << ( elapsed() /1000.0 ) << qPrintable( text );
-        }
+        // set filePath to the next file to guess and return true, false at the end of the input, only called from the batch thread
+        virtual bool next( QString& filePath ) = 0;
+    };
     
-    protected:
-        QString name;
+    // output of a streamed batch
+    class DOCUMENTPROPERTIESDISCOVER_EXPORT PropertiesSink {
+    public:
+        virtual ~PropertiesSink() {}
+        
+        // called once per file as soon as it's guessed, in completion order from worker threads, calls never overlap
+        virtual void receive( qint64 index, const QString& filePath, const DocumentPropertiesDiscover::GuessedProperties& properties ) = 0;
     };
     
-    DocumentPropertiesDiscover::Eol defaultEol();
-    void setDefaultEol( DocumentPropertiesDiscover::Eol eol );
+    DOCUMENTPROPERTIESDISCOVER_EXPORT DocumentPropertiesDiscover::Eol defaultEol();
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void setDefaultEol( DocumentPropertiesDiscover::Eol eol );
+    
+    DOCUMENTPROPERTIESDISCOVER_EXPORT DocumentPropertiesDiscover::Indent defaultIndent();
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void setDefaultIndent( DocumentPropertiesDiscover::Indent indent );
+    
+    DOCUMENTPROPERTIESDISCOVER_EXPORT int defaultIndentWidth();
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void setDefaultIndentWidth( int indentWidth );
+    
+    DOCUMENTPROPERTIESDISCOVER_EXPORT int defaultTabWidth();
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void setDefaultTabWidth( int tabWidth );
+    
+    // files of at least this size are streamed instead of being loaded in memory, clamped to 256 MiB
+    DOCUMENTPROPERTIESDISCOVER_EXPORT qint64 largeFileThreshold();
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void setLargeFileThreshold( qint64 size );
+    
+    // use the properties declared by .editorconfig files, only undeclared ones are guessed from the content
+    DOCUMENTPROPERTIESDISCOVER_EXPORT bool editorConfigEnabled();
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void setEditorConfigEnabled( bool enabled );
+    
+    // files of a batch with identical contents are guessed once
+    DOCUMENTPROPERTIESDISCOVER_EXPORT bool contentDeduplicationEnabled();
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void setContentDeduplicationEnabled( bool enabled );
+    
+    // contents whose first bytes look binary are not decoded nor parsed, UTF-16 and UTF-32 codecs are never rejected
+    DOCUMENTPROPERTIESDISCOVER_EXPORT bool binaryDetectionEnabled();
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void setBinaryDetectionEnabled( bool enabled );
     
-    DocumentPropertiesDiscover::Indent defaultIndent();
-    void setDefaultIndent( DocumentPropertiesDiscover::Indent indent );
+    // bytes looked at by the binary detection
+    DOCUMENTPROPERTIESDISCOVER_EXPORT int binaryDetectionPrefixSize();
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void setBinaryDetectionPrefixSize( int size );
     
-    int defaultIndentWidth();
-    void setDefaultIndentWidth( int indentWidth );
+    // true if the first binaryDetectionPrefixSize() bytes of data have a known binary magic number, a NUL byte or too many control chars
+    DOCUMENTPROPERTIESDISCOVER_EXPORT bool isBinaryData( const QByteArray& data );
     
-    int defaultTabWidth();
-    void setDefaultTabWidth( int tabWidth );
+    DOCUMENTPROPERTIESDISCOVER_EXPORT DocumentPropertiesDiscover::GuessedProperties guessContentProperties( const QString& content, bool detectEol, bool detectIndent, DocumentPropertiesDiscover::Counters* counters = 0 );
+    DOCUMENTPROPERTIESDISCOVER_EXPORT DocumentPropertiesDiscover::GuessedProperties guessFileProperties( const QString& filePath, bool detectEol, bool detectIndent, const QByteArray& codec = QByteArray( "UTF-8" ), DocumentPropertiesDiscover::Counters* counters = 0 );
+    DOCUMENTPROPERTIESDISCOVER_EXPORT DocumentPropertiesDiscover::GuessedProperties guessDataProperties( const QByteArray& data, bool detectEol, bool detectIndent, const QByteArray& codec = QByteArray( "UTF-8" ), DocumentPropertiesDiscover::Counters* counters = 0 );
+    DOCUMENTPROPERTIESDISCOVER_EXPORT DocumentPropertiesDiscover::GuessedProperties guessDeviceProperties( QIODevice* device, bool detectEol, bool detectIndent, const QByteArray& codec = QByteArray( "UTF-8" ), DocumentPropertiesDiscover::Counters* counters = 0 );
+    DOCUMENTPROPERTIESDISCOVER_EXPORT DocumentPropertiesDiscover::GuessedProperties::List guessFilesProperties( const QStringList& filePaths, bool detectEol, bool detectIndent, const QByteArray& codec = QByteArray( "UTF-8" ), DocumentPropertiesDiscover::BatchStatistics* statistics = 0 );
     
-    DocumentPropertiesDiscover::GuessedProperties guessContentProperties( const QString& content, bool detectEol, bool detectIndent );
-    DocumentPropertiesDiscover::GuessedProperties guessFileProperties( const QString& filePath, bool detectEol, bool detectIndent, const QByteArray& codec = QByteArray( "UTF-8" ) );
-    DocumentPropertiesDiscover::GuessedProperties::List guessFilesProperties( const QStringList& filePaths, bool detectEol, bool detectIndent, const QByteArray& codec = QByteArray( "UTF-8" ) );
+    /*
+        Pull the files from source and hand each result to sink, with at most maximumInFlight files pulled and not yet received.
+        source is not asked for more files while the window is full, so memory stays flat whatever the input size.
+        Contents are not deduplicated, that would need to keep every content hash of the input.
+        Returns once every file has been received.
+    */
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void guessFilesProperties( DocumentPropertiesDiscover::FilePathSource* source, DocumentPropertiesDiscover::PropertiesSink* sink, bool detectEol, bool detectIndent, const QByteArray& codec = QByteArray( "UTF-8" ), int maximumInFlight = 256, DocumentPropertiesDiscover::BatchStatistics* statistics = 0 );
     
-    void convertContent( QString& content, const DocumentPropertiesDiscover::GuessedProperties& from, const DocumentPropertiesDiscover::GuessedProperties& to, bool convertEol, bool convertIndent );
+    // edits needed to convert content, sorted by offset and not overlapping, unchanged lines have no edit
+    DOCUMENTPROPERTIESDISCOVER_EXPORT DocumentPropertiesDiscover::Edit::List contentEdits( const QString& content, const DocumentPropertiesDiscover::GuessedProperties& from, const DocumentPropertiesDiscover::GuessedProperties& to, bool convertEol, bool convertIndent );
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void applyEdits( QString& content, const DocumentPropertiesDiscover::Edit::List& edits );
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void convertContent( QString& content, const DocumentPropertiesDiscover::GuessedProperties& from, const DocumentPropertiesDiscover::GuessedProperties& to, bool convertEol, bool convertIndent );
 };
 
 Q_DECLARE_METATYPE( DocumentPropertiesDiscover::GuessedProperties )
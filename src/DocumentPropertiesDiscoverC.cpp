@@ -0,0 +1,165 @@
+#include "DocumentPropertiesDiscoverC.h"
+#include "DocumentPropertiesDiscover.h"
+#include "DocumentPropertiesDiscoverPrivate.h"
+
+#include <QFile>
+#include <QTextCodec>
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+namespace DocumentPropertiesDiscover {
+    QByteArray codecName( const char* codec ) {
+        return codec ? QByteArray( codec ) : QByteArray( "UTF-8" );
+    }
+    
+    void toProperties( const DocumentPropertiesDiscover::GuessedProperties& guessed, dpd_properties* properties ) {
+        properties->eol = guessed.eol;
+        properties->indent = guessed.indent;
+        properties->indent_width = guessed.indentWidth;
+        properties->tab_width = guessed.tabWidth;
+        properties->flags = guessed.binary ? DPD_FLAG_BINARY : 0;
+    }
+    
+    DocumentPropertiesDiscover::GuessedProperties fromProperties( const dpd_properties* properties ) {
+        return DocumentPropertiesDiscover::GuessedProperties( properties->eol, properties->indent, properties->indent_width, properties->tab_width );
+    }
+    
+    bool isValidEol( int eol ) {
+        return eol == DPD_EOL_UNIX || eol == DPD_EOL_DOS || eol == DPD_EOL_MACOS;
+    }
+    
+    bool isValidIndent( const dpd_properties* properties ) {
+        return
+            ( properties->indent == DPD_INDENT_TABS || properties->indent == DPD_INDENT_SPACES || properties->indent == DPD_INDENT_MIXED ) &&
+            properties->indent_width > 0 &&
+            properties->tab_width > 0
+        ;
+    }
+    
+    void toCounters( const DocumentPropertiesDiscover::Counters& raw, dpd_counters* counters ) {
+        if ( !counters ) {
+            return;
+        }
+        
+        counters->lines = raw.lines;
+        counters->indent_hints = raw.indentHints;
+        counters->unix_eols = raw.unixEols;
+        counters->dos_eols = raw.dosEols;
+        counters->macos_eols = raw.macOSEols;
+        counters->tabs = raw.tabs;
+        
+        for ( int i = 0; i < 9; i++ ) {
+            counters->spaces[ i ] = raw.spaces[ i ];
+            counters->mixed[ i ] = raw.mixed[ i ];
+        }
+    }
+}
+
+int dpd_abi_version( void )
+{
+    return DPD_ABI_VERSION;
+}
+
+int dpd_guess_buffer( const char* data, size_t size, const char* codec, int detect, dpd_properties* properties, dpd_counters* counters )
+{
+    if ( ( !data && size > 0 ) || size > size_t( INT_MAX ) || !properties ) {
+        return DPD_ERROR_INVALID_ARGUMENT;
+    }
+    
+    // exceptions must not cross the C boundary, Qt only throws std::bad_alloc
+    try {
+        // an unknown codec would silently fall back to the locale one
+        if ( !QTextCodec::codecForName( DocumentPropertiesDiscover::codecName( codec ) ) ) {
+            return DPD_ERROR_CODEC;
+        }
+        
+        // the caller memory is used as is, no copy
+        const QByteArray buffer = QByteArray::fromRawData( data, int( size ) );
+        DocumentPropertiesDiscover::Counters raw;
+        const DocumentPropertiesDiscover::GuessedProperties guessed = DocumentPropertiesDiscover::guessDataProperties( buffer, detect & DPD_EOL, detect & DPD_INDENT, DocumentPropertiesDiscover::codecName( codec ), &raw );
+        
+        DocumentPropertiesDiscover::toProperties( guessed, properties );
+        DocumentPropertiesDiscover::toCounters( raw, counters );
+        return DPD_OK;
+    }
+    catch ( ... ) {
+        return DPD_ERROR_MEMORY;
+    }
+}
+
+int dpd_guess_file( const char* path, const char* codec, int detect, dpd_properties* properties, dpd_counters* counters )
+{
+    if ( !path || !properties ) {
+        return DPD_ERROR_INVALID_ARGUMENT;
+    }
+    
+    try {
+        if ( !QTextCodec::codecForName( DocumentPropertiesDiscover::codecName( codec ) ) ) {
+            return DPD_ERROR_CODEC;
+        }
+        
+        DocumentPropertiesDiscover::Counters raw;
+        DocumentPropertiesDiscover::FileOutcome outcome;
+        const DocumentPropertiesDiscover::GuessedProperties guessed = DocumentPropertiesDiscover::guessFile( QFile::decodeName( path ), detect & DPD_EOL, detect & DPD_INDENT, DocumentPropertiesDiscover::codecName( codec ), &raw, outcome );
+        
+        if ( outcome == DocumentPropertiesDiscover::FailedFile ) {
+            return DPD_ERROR_IO;
+        }
+        
+        DocumentPropertiesDiscover::toProperties( guessed, properties );
+        DocumentPropertiesDiscover::toCounters( raw, counters );
+        return DPD_OK;
+    }
+    catch ( ... ) {
+        return DPD_ERROR_MEMORY;
+    }
+}
+
+int dpd_convert_buffer( const char* data, size_t size, const char* _codec, const dpd_properties* from, const dpd_properties* to, int convert, char** output, size_t* output_size )
+{
+    if ( ( !data && size > 0 ) || size > size_t( INT_MAX ) || !from || !to || !output || !output_size ) {
+        return DPD_ERROR_INVALID_ARGUMENT;
+    }
+    
+    // an undefined eol would join all lines, null widths give meaningless indent patterns
+    if ( ( convert & DPD_EOL ) && !DocumentPropertiesDiscover::isValidEol( to->eol ) ) {
+        return DPD_ERROR_INVALID_ARGUMENT;
+    }
+    
+    if ( ( convert & DPD_INDENT ) && ( from->tab_width <= 0 || !DocumentPropertiesDiscover::isValidIndent( to ) ) ) {
+        return DPD_ERROR_INVALID_ARGUMENT;
+    }
+    
+    try {
+        QTextCodec* codec = QTextCodec::codecForName( DocumentPropertiesDiscover::codecName( _codec ) );
+        
+        if ( !codec ) {
+            return DPD_ERROR_CODEC;
+        }
+        
+        QString content = codec->toUnicode( data, int( size ) );
+        DocumentPropertiesDiscover::convertContent( content, DocumentPropertiesDiscover::fromProperties( from ), DocumentPropertiesDiscover::fromProperties( to ), convert & DPD_EOL, convert & DPD_INDENT );
+        
+        const QByteArray converted = codec->fromUnicode( content );
+        char* buffer = static_cast<char*>( malloc( converted.size() +1 ) );
+        
+        if ( !buffer ) {
+            return DPD_ERROR_MEMORY;
+        }
+        
+        memcpy( buffer, converted.constData(), converted.size() +1 );
+        *output = buffer;
+        *output_size = converted.size();
+        return DPD_OK;
+    }
+    catch ( ... ) {
+        return DPD_ERROR_MEMORY;
+    }
+}
+
+void dpd_free( void* buffer )
+{
+    free( buffer );
+}
@@ -0,0 +1,103 @@
+#ifndef DOCUMENTPROPERTIESDISCOVERC_H
+#define DOCUMENTPROPERTIESDISCOVERC_H
+
+/*
+    Stable C ABI of the document-properties-discover library.
+    
+    Structures only hold plain values and are never changed once released, new features come with new
+    functions and a bigger DPD_ABI_VERSION. Functions return DPD_OK or a negative DPD_ERROR_* value.
+*/
+
+#include <stddef.h>
+
+#if defined( DPD_STATIC )
+#define DPD_EXPORT
+#elif defined( _WIN32 )
+#if defined( DPD_BUILD_LIBRARY )
+#define DPD_EXPORT __declspec( dllexport )
+#else
+#define DPD_EXPORT __declspec( dllimport )
+#endif
+#else
+#define DPD_EXPORT __attribute__( ( visibility( "default" ) ) )
+#endif
+
+#define DPD_ABI_VERSION 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* values of DocumentPropertiesDiscover::Eol */
+enum {
+    DPD_EOL_UNDEFINED = 0x0,
+    DPD_EOL_UNIX = 0x1,
+    DPD_EOL_DOS = 0x2,
+    DPD_EOL_MACOS = 0x4
+};
+
+/* values of DocumentPropertiesDiscover::Indent */
+enum {
+    DPD_INDENT_UNDEFINED = 0x0,
+    DPD_INDENT_TABS = 0x1,
+    DPD_INDENT_SPACES = 0x2,
+    DPD_INDENT_MIXED = 0x3
+};
+
+/* detection / conversion flags */
+enum {
+    DPD_EOL = 0x1,
+    DPD_INDENT = 0x2
+};
+
+/* dpd_properties flags */
+enum {
+    DPD_FLAG_BINARY = 0x1 /* the content has been rejected as binary, other members are undefined */
+};
+
+enum {
+    DPD_OK = 0,
+    DPD_ERROR_INVALID_ARGUMENT = -1,
+    DPD_ERROR_IO = -2,
+    DPD_ERROR_CODEC = -3,
+    DPD_ERROR_MEMORY = -4
+};
+
+typedef struct dpd_properties {
+    int eol; /* DPD_EOL_* */
+    int indent; /* DPD_INDENT_* */
+    int indent_width; /* indent size in spaces */
+    int tab_width; /* tab size in spaces */
+    int flags; /* DPD_FLAG_*, unknown flags must be ignored */
+} dpd_properties;
+
+typedef struct dpd_counters {
+    long long lines; /* processed lines */
+    long long indent_hints; /* lines giving an indentation hint */
+    long long unix_eols;
+    long long dos_eols;
+    long long macos_eols;
+    long long tabs; /* lines indented by one more tab than the previous one */
+    long long spaces[ 9 ]; /* lines indented by n ( 2 to 8 ) more spaces than the previous one */
+    long long mixed[ 9 ]; /* lines indented by n ( 2 to 8 ) more mixed spaces than the previous one */
+} dpd_counters;
+
+/* DPD_ABI_VERSION the library has been built with */
+DPD_EXPORT int dpd_abi_version( void );
+
+/* codec may be NULL for UTF-8, an unknown codec gives DPD_ERROR_CODEC, counters may be NULL */
+DPD_EXPORT int dpd_guess_buffer( const char* data, size_t size, const char* codec, int detect, dpd_properties* properties, dpd_counters* counters );
+DPD_EXPORT int dpd_guess_file( const char* path, const char* codec, int detect, dpd_properties* properties, dpd_counters* counters );
+
+/*
+    *output is allocated by the library and must be released with dpd_free().
+    DPD_EOL needs a defined to->eol, DPD_INDENT a defined to->indent and positive widths.
+*/
+DPD_EXPORT int dpd_convert_buffer( const char* data, size_t size, const char* codec, const dpd_properties* from, const dpd_properties* to, int convert, char** output, size_t* output_size );
+DPD_EXPORT void dpd_free( void* buffer );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DOCUMENTPROPERTIESDISCOVERC_H */
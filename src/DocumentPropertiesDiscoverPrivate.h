@@ -0,0 +1,21 @@
+#ifndef DOCUMENTPROPERTIESDISCOVERPRIVATE_H
+#define DOCUMENTPROPERTIESDISCOVERPRIVATE_H
+
+#include "DocumentPropertiesDiscover.h"
+
+// library internals shared by the C++ and C front ends, not installed
+
+namespace DocumentPropertiesDiscover
+{
+    enum FileOutcome {
+        GuessedFile,
+        DeclaredFile, // fully declared by .editorconfig, not read
+        FailedFile, // can't be read
+        BinaryFile // rejected from its first bytes, not read further
+    };
+    
+    // guessFileProperties() also telling what happened to the file
+    DocumentPropertiesDiscover::GuessedProperties guessFile( const QString& filePath, bool detectEol, bool detectIndent, const QByteArray& codec, DocumentPropertiesDiscover::Counters* counters, DocumentPropertiesDiscover::FileOutcome& outcome );
+};
+
+#endif // DOCUMENTPROPERTIESDISCOVERPRIVATE_H
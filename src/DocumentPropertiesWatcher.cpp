@@ -0,0 +1,592 @@
+#include "DocumentPropertiesWatcher.h"
+#include "EditorConfig.h"
+
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QIODevice>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+#if defined( Q_OS_LINUX )
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#if defined( Q_OS_LINUX )
+namespace DocumentPropertiesDiscover {
+    // directory watches only, content writes are reported by IN_CLOSE_WRITE on the directory so files need no watch of their own
+    const uint32_t inotifyMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW;
+}
+#endif
+
+DocumentPropertiesDiscover::Watcher::Watcher( QObject* parent )
+    : QObject( parent )
+{
+    watcher = 0;
+    notifier = 0;
+    inotifyFd = -1;
+    timer = new QTimer( this );
+    eolDetection = true;
+    indentDetection = true;
+    codecName = "UTF-8";
+    output = 0;
+    
+    timer->setSingleShot( true );
+    timer->setInterval( 200 );
+
+#if defined( Q_OS_LINUX )
+    inotifyFd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    
+    if ( inotifyFd != -1 ) {
+        notifier = new QSocketNotifier( inotifyFd, QSocketNotifier::Read, this );
+        connect( notifier, SIGNAL( activated( int ) ), this, SLOT( inotifyActivated() ) );
+    }
+#endif
+    
+    // QFileSystemWatcher needs a watch per file to see content writes, it's only used without inotify
+    if ( inotifyFd == -1 ) {
+        watcher = new QFileSystemWatcher( this );
+        connect( watcher, SIGNAL( directoryChanged( const QString& ) ), this, SLOT( directoryChanged( const QString& ) ) );
+        connect( watcher, SIGNAL( fileChanged( const QString& ) ), this, SLOT( fileChanged( const QString& ) ) );
+    }
+    
+    connect( timer, SIGNAL( timeout() ), this, SLOT( processPendingFiles() ) );
+}
+
+DocumentPropertiesDiscover::Watcher::~Watcher()
+{
+#if defined( Q_OS_LINUX )
+    if ( inotifyFd != -1 ) {
+        delete notifier;
+        ::close( inotifyFd );
+    }
+#endif
+}
+
+bool DocumentPropertiesDiscover::Watcher::detectEol() const
+{
+    return eolDetection;
+}
+
+bool DocumentPropertiesDiscover::Watcher::detectIndent() const
+{
+    return indentDetection;
+}
+
+QByteArray DocumentPropertiesDiscover::Watcher::codec() const
+{
+    return codecName;
+}
+
+void DocumentPropertiesDiscover::Watcher::setDetection( bool detectEol, bool detectIndent, const QByteArray& codec )
+{
+    eolDetection = detectEol;
+    indentDetection = detectIndent;
+    codecName = codec;
+}
+
+int DocumentPropertiesDiscover::Watcher::debounceInterval() const
+{
+    return timer->interval();
+}
+
+void DocumentPropertiesDiscover::Watcher::setDebounceInterval( int msecs )
+{
+    timer->setInterval( msecs );
+}
+
+QIODevice* DocumentPropertiesDiscover::Watcher::outputDevice() const
+{
+    return output;
+}
+
+void DocumentPropertiesDiscover::Watcher::setOutputDevice( QIODevice* device )
+{
+    output = device;
+}
+
+QString DocumentPropertiesDiscover::Watcher::rootPath() const
+{
+    return root;
+}
+
+bool DocumentPropertiesDiscover::Watcher::watch( const QString& rootPath )
+{
+    stop();
+    
+    const QFileInfo fi( rootPath );
+    
+    if ( !fi.exists() || !fi.isDir() ) {
+        return false;
+    }
+    
+    QStringList filePaths;
+    
+    root = fi.absoluteFilePath();
+    addDirectory( root, filePaths );
+    update( filePaths );
+    
+    return true;
+}
+
+void DocumentPropertiesDiscover::Watcher::stop()
+{
+    timer->stop();
+    pendingFiles.clear();
+    
+    if ( watcher && !watcher->files().isEmpty() ) {
+        watcher->removePaths( watcher->files() );
+    }
+    
+    if ( watcher && !watcher->directories().isEmpty() ) {
+        watcher->removePaths( watcher->directories() );
+    }
+
+#if defined( Q_OS_LINUX )
+    foreach ( const int wd, watchDirectories.keys() ) {
+        inotify_rm_watch( inotifyFd, wd );
+    }
+#endif
+    
+    watchDirectories.clear();
+    directoryWatches.clear();
+    
+    directoryFiles.clear();
+    editorConfigDirectories.clear();
+    cache.clear();
+    root.clear();
+}
+
+QHash<QString, DocumentPropertiesDiscover::GuessedProperties> DocumentPropertiesDiscover::Watcher::properties() const
+{
+    return cache;
+}
+
+DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::Watcher::properties( const QString& filePath ) const
+{
+    return cache.value( filePath, DocumentPropertiesDiscover::GuessedProperties::null );
+}
+
+void DocumentPropertiesDiscover::Watcher::addDirectory( const QString& path, QStringList& filePaths )
+{
+    // watch before listing, so that entries created meanwhile are either listed or reported
+    watchDirectory( path );
+    
+    const QFileInfoList entries = QDir( path ).entryInfoList( QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks );
+    QSet<QString> fileNames;
+    QStringList newFilePaths;
+    
+    foreach ( const QFileInfo& fi, entries ) {
+        if ( fi.isDir() ) {
+            addDirectory( fi.absoluteFilePath(), filePaths );
+        }
+        else {
+            fileNames << fi.fileName();
+            newFilePaths << fi.absoluteFilePath();
+        }
+    }
+    
+    directoryFiles[ path ] = fileNames;
+    
+    if ( QFileInfo( QString( "%1/.editorconfig" ).arg( path ) ).isFile() ) {
+        editorConfigDirectories << path;
+        watchFiles( QStringList( QString( "%1/.editorconfig" ).arg( path ) ) );
+    }
+    
+    if ( !newFilePaths.isEmpty() ) {
+        watchFiles( newFilePaths );
+        filePaths << newFilePaths;
+    }
+}
+
+void DocumentPropertiesDiscover::Watcher::removeDirectory( const QString& path )
+{
+    const QString prefix = QString( "%1/" ).arg( path );
+    
+    foreach ( const QString& directory, directoryFiles.keys() ) {
+        if ( directory != path && !directory.startsWith( prefix ) ) {
+            continue;
+        }
+        
+        foreach ( const QString& fileName, directoryFiles[ directory ] ) {
+            removeFile( QString( "%1/%2" ).arg( directory ).arg( fileName ) );
+        }
+        
+        if ( editorConfigDirectories.remove( directory ) ) {
+            unwatchFile( QString( "%1/.editorconfig" ).arg( directory ) );
+        }
+        
+        // also keeps the .editorconfig cache from growing with removed directories
+        DocumentPropertiesDiscover::invalidateEditorConfig( directory );
+        directoryFiles.remove( directory );
+        unwatchDirectory( directory );
+    }
+}
+
+void DocumentPropertiesDiscover::Watcher::removeFile( const QString& filePath )
+{
+    pendingFiles.remove( filePath );
+    unwatchFile( filePath );
+    
+    if ( cache.remove( filePath ) > 0 ) {
+        publish( filePath, "removed" );
+        emit fileRemoved( filePath );
+    }
+}
+
+bool DocumentPropertiesDiscover::Watcher::watchDirectory( const QString& path )
+{
+#if defined( Q_OS_LINUX )
+    if ( inotifyFd != -1 ) {
+        const int wd = inotify_add_watch( inotifyFd, QFile::encodeName( path ).constData(), DocumentPropertiesDiscover::inotifyMask );
+        
+        if ( wd == -1 ) {
+            // ENOSPC is fs.inotify.max_user_watches being reached
+            watchFailure( path, QString::fromLocal8Bit( strerror( errno ) ) );
+            return false;
+        }
+        
+        // a moved directory keeps its watch descriptor, forget its old path
+        const QString previousPath = watchDirectories.value( wd );
+        
+        if ( !previousPath.isEmpty() ) {
+            directoryWatches.remove( previousPath );
+        }
+        
+        watchDirectories[ wd ] = path;
+        directoryWatches[ path ] = wd;
+        return true;
+    }
+#endif
+    
+    const int count = watcher->directories().count();
+    watcher->addPath( path );
+    
+    if ( watcher->directories().count() == count ) {
+        watchFailure( path, "QFileSystemWatcher refused it" );
+        return false;
+    }
+    
+    return true;
+}
+
+void DocumentPropertiesDiscover::Watcher::unwatchDirectory( const QString& path )
+{
+#if defined( Q_OS_LINUX )
+    if ( inotifyFd != -1 ) {
+        QHash<QString, int>::iterator it = directoryWatches.find( path );
+        
+        if ( it != directoryWatches.end() ) {
+            // the kernel already dropped the watch of a removed directory, the call then fails harmlessly
+            inotify_rm_watch( inotifyFd, it.value() );
+            watchDirectories.remove( it.value() );
+            directoryWatches.erase( it );
+        }
+        
+        return;
+    }
+#endif
+    
+    watcher->removePath( path );
+}
+
+void DocumentPropertiesDiscover::Watcher::watchFiles( const QStringList& filePaths )
+{
+    // directory watches cover the files with inotify
+    if ( !watcher || filePaths.isEmpty() ) {
+        return;
+    }
+    
+    const int count = watcher->files().count();
+    watcher->addPaths( filePaths );
+    
+    if ( watcher->files().count() -count == filePaths.count() ) {
+        return;
+    }
+    
+    const QSet<QString> watchedFilePaths = watcher->files().toSet();
+    
+    foreach ( const QString& filePath, filePaths ) {
+        if ( !watchedFilePaths.contains( filePath ) ) {
+            watchFailure( filePath, "QFileSystemWatcher refused it" );
+        }
+    }
+}
+
+void DocumentPropertiesDiscover::Watcher::unwatchFile( const QString& filePath )
+{
+    if ( watcher ) {
+        watcher->removePath( filePath );
+    }
+}
+
+void DocumentPropertiesDiscover::Watcher::watchFailure( const QString& path, const QString& reason )
+{
+    qWarning( "Watcher: can't watch %s (%s), its changes will be missed", qPrintable( path ), qPrintable( reason ) );
+    publish( path, "unwatched" );
+    emit watchFailed( path );
+}
+
+// guess a written file again, .editorconfig files guess their whole tree again
+void DocumentPropertiesDiscover::Watcher::fileWritten( const QString& filePath )
+{
+    const QFileInfo fi( filePath );
+    
+    if ( fi.fileName() == ".editorconfig" ) {
+        editorConfigChanged( fi.path() );
+    }
+    // hidden files are not tracked
+    else if ( directoryFiles.value( fi.path() ).contains( fi.fileName() ) ) {
+        schedule( filePath );
+    }
+}
+
+// follow the creation or removal of the .editorconfig of path
+void DocumentPropertiesDiscover::Watcher::updateEditorConfig( const QString& path )
+{
+    const QString filePath = QString( "%1/.editorconfig" ).arg( path );
+    const bool exists = QFileInfo( filePath ).isFile();
+    
+    if ( exists == editorConfigDirectories.contains( path ) ) {
+        return;
+    }
+    
+    if ( exists ) {
+        editorConfigDirectories << path;
+        watchFiles( QStringList( filePath ) );
+    }
+    else {
+        editorConfigDirectories.remove( path );
+        unwatchFile( filePath );
+    }
+    
+    editorConfigChanged( path );
+}
+
+// the declared properties of the whole path tree may have changed
+void DocumentPropertiesDiscover::Watcher::editorConfigChanged( const QString& path )
+{
+    const QString prefix = QString( "%1/" ).arg( path );
+    
+    DocumentPropertiesDiscover::invalidateEditorConfig( path );
+    
+    foreach ( const QString& directory, directoryFiles.keys() ) {
+        if ( directory != path && !directory.startsWith( prefix ) ) {
+            continue;
+        }
+        
+        foreach ( const QString& fileName, directoryFiles[ directory ] ) {
+            schedule( QString( "%1/%2" ).arg( directory ).arg( fileName ) );
+        }
+    }
+}
+
+void DocumentPropertiesDiscover::Watcher::schedule( const QString& filePath )
+{
+    if ( pendingFiles.isEmpty() ) {
+        pendingTime.start();
+    }
+    
+    pendingFiles << filePath;
+    
+    // restart the debounce delay on each event, unless the oldest pending event waits for too long already
+    if ( !timer->isActive() || pendingTime.elapsed() < timer->interval() *4 ) {
+        timer->start();
+    }
+}
+
+void DocumentPropertiesDiscover::Watcher::update( const QStringList& filePaths )
+{
+    if ( filePaths.isEmpty() ) {
+        return;
+    }
+    
+    const DocumentPropertiesDiscover::GuessedProperties::List propertiesList = DocumentPropertiesDiscover::guessFilesProperties( filePaths, eolDetection, indentDetection, codecName );
+    
+    for ( int i = 0; i < filePaths.count(); i++ ) {
+        const QString& filePath = filePaths[ i ];
+        const DocumentPropertiesDiscover::GuessedProperties& properties = propertiesList[ i ];
+        QHash<QString, DocumentPropertiesDiscover::GuessedProperties>::iterator it = cache.find( filePath );
+        
+        if ( it != cache.end() && it.value() == properties ) {
+            continue;
+        }
+        
+        cache[ filePath ] = properties;
+        publish( filePath, properties.toString() );
+        emit propertiesChanged( filePath, properties );
+    }
+}
+
+void DocumentPropertiesDiscover::Watcher::publish( const QString& filePath, const QString& text )
+{
+    if ( !output ) {
+        return;
+    }
+    
+    output->write( QString( "%1\t%2\n" ).arg( filePath ).arg( text ).toUtf8() );
+}
+
+void DocumentPropertiesDiscover::Watcher::directoryChanged( const QString& path )
+{
+    if ( !directoryFiles.contains( path ) ) {
+        return;
+    }
+    
+    if ( !QFileInfo( path ).exists() ) {
+        removeDirectory( path );
+        return;
+    }
+    
+    // only the changed directory is listed again, not the whole tree
+    const QFileInfoList entries = QDir( path ).entryInfoList( QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks );
+    QSet<QString> removedFileNames = directoryFiles[ path ];
+    QSet<QString> fileNames;
+    QStringList newFilePaths;
+    QStringList createdFilePaths;
+    
+    foreach ( const QFileInfo& fi, entries ) {
+        const QString filePath = fi.absoluteFilePath();
+        
+        if ( fi.isDir() ) {
+            if ( !directoryFiles.contains( filePath ) ) {
+                addDirectory( filePath, newFilePaths );
+            }
+        }
+        else {
+            fileNames << fi.fileName();
+            
+            if ( !removedFileNames.remove( fi.fileName() ) ) {
+                createdFilePaths << filePath;
+                newFilePaths << filePath;
+            }
+        }
+    }
+    
+    directoryFiles[ path ] = fileNames;
+    watchFiles( createdFilePaths );
+    
+    foreach ( const QString& fileName, removedFileNames ) {
+        removeFile( QString( "%1/%2" ).arg( path ).arg( fileName ) );
+    }
+    
+    foreach ( const QString& filePath, newFilePaths ) {
+        schedule( filePath );
+    }
+    
+    // hidden files are not listed, check the .editorconfig on its own
+    updateEditorConfig( path );
+}
+
+void DocumentPropertiesDiscover::Watcher::fileChanged( const QString& filePath )
+{
+    // files replaced by a rename lose their watch, watch the new file again
+    unwatchFile( filePath );
+    
+    // removed files are handled by directoryChanged()
+    if ( !QFileInfo( filePath ).exists() ) {
+        return;
+    }
+    
+    watchFiles( QStringList( filePath ) );
+    fileWritten( filePath );
+}
+
+void DocumentPropertiesDiscover::Watcher::inotifyActivated()
+{
+#if defined( Q_OS_LINUX )
+    char buffer[ 64 *1024 ] __attribute__( ( aligned( __alignof__( struct inotify_event ) ) ) );
+    QSet<QString> changedDirectories;
+    QStringList writtenFilePaths;
+    bool overflow = false;
+    
+    // drain the queue, events of a burst are coalesced by directory
+    forever {
+        const ssize_t length = ::read( inotifyFd, buffer, sizeof( buffer ) );
+        
+        if ( length == -1 && errno == EINTR ) {
+            continue;
+        }
+        
+        if ( length <= 0 ) {
+            break;
+        }
+        
+        for ( const char* p = buffer; p < buffer +length; ) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>( p );
+            p += sizeof( struct inotify_event ) +event->len;
+            
+            if ( event->mask & IN_Q_OVERFLOW ) {
+                overflow = true;
+                continue;
+            }
+            
+            const QString directory = watchDirectories.value( event->wd );
+            
+            if ( directory.isEmpty() ) {
+                continue;
+            }
+            
+            // the directory itself is gone, directoryChanged() removes it
+            if ( event->mask & ( IN_DELETE_SELF | IN_MOVE_SELF ) ) {
+                changedDirectories << directory;
+                continue;
+            }
+            
+            if ( event->mask & ( IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO ) ) {
+                changedDirectories << directory;
+            }
+            
+            // a rename over an existing file keeps its name, so it's a write too
+            if ( ( event->mask & ( IN_CLOSE_WRITE | IN_MOVED_TO ) ) && !( event->mask & IN_ISDIR ) && event->len > 0 ) {
+                writtenFilePaths << QString( "%1/%2" ).arg( directory ).arg( QFile::decodeName( event->name ) );
+            }
+        }
+    }
+    
+    // events were lost, list the whole tree again
+    if ( overflow ) {
+        changedDirectories += directoryFiles.keys().toSet();
+    }
+    
+    foreach ( const QString& directory, changedDirectories ) {
+        directoryChanged( directory );
+    }
+    
+    // lost writes leave no trace in the listings, so every file and .editorconfig is read again
+    if ( overflow ) {
+        foreach ( const QString& directory, directoryFiles.keys() ) {
+            DocumentPropertiesDiscover::invalidateEditorConfig( directory );
+            
+            foreach ( const QString& fileName, directoryFiles[ directory ] ) {
+                schedule( QString( "%1/%2" ).arg( directory ).arg( fileName ) );
+            }
+        }
+    }
+    
+    foreach ( const QString& filePath, writtenFilePaths ) {
+        if ( QFileInfo( filePath ).exists() ) {
+            fileWritten( filePath );
+        }
+    }
+#endif
+}
+
+void DocumentPropertiesDiscover::Watcher::processPendingFiles()
+{
+    QStringList filePaths;
+    
+    foreach ( const QString& filePath, pendingFiles ) {
+        if ( QFileInfo( filePath ).exists() ) {
+            filePaths << filePath;
+        }
+    }
+    
+    pendingFiles.clear();
+    update( filePaths );
+}
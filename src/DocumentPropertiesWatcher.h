@@ -0,0 +1,100 @@
+#ifndef DOCUMENTPROPERTIESWATCHER_H
+#define DOCUMENTPROPERTIESWATCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QTime>
+
+#include "DocumentPropertiesDiscover.h"
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+class QTimer;
+class QIODevice;
+
+namespace DocumentPropertiesDiscover
+{
+    /*
+        Keep the guessed properties of a directory tree up to date.
+        
+        On Linux directories are watched with inotify, so the number of watches grows with directories, not files.
+        Elsewhere, or when inotify is not available, QFileSystemWatcher is used with a watch per file.
+        Paths that can't be watched are reported with watchFailed() and written to outputDevice() as "unwatched".
+        An initial concurrent scan fills the cache, then only created or modified files are guessed again.
+        .editorconfig files are watched too, changing one guesses its whole directory tree again.
+        Events are coalesced during debounceInterval() msecs so that bursts of writes on the same file are guessed once.
+        Updated results are emitted with propertiesChanged() and written to outputDevice() if any.
+    */
+    class DOCUMENTPROPERTIESDISCOVER_EXPORT Watcher : public QObject {
+        Q_OBJECT
+    
+    public:
+        Watcher( QObject* parent = 0 );
+        virtual ~Watcher();
+        
+        bool detectEol() const;
+        bool detectIndent() const;
+        QByteArray codec() const;
+        void setDetection( bool detectEol, bool detectIndent, const QByteArray& codec = QByteArray( "UTF-8" ) );
+        
+        int debounceInterval() const;
+        void setDebounceInterval( int msecs );
+        
+        QIODevice* outputDevice() const;
+        void setOutputDevice( QIODevice* device );
+        
+        QString rootPath() const;
+        bool watch( const QString& rootPath );
+        void stop();
+        
+        QHash<QString, DocumentPropertiesDiscover::GuessedProperties> properties() const;
+        DocumentPropertiesDiscover::GuessedProperties properties( const QString& filePath ) const;
+    
+    protected:
+        QFileSystemWatcher* watcher; // fallback backend, null when inotify is used
+        QSocketNotifier* notifier;
+        int inotifyFd;
+        QHash<int, QString> watchDirectories; // inotify watch descriptor -> directory path
+        QHash<QString, int> directoryWatches; // directory path -> inotify watch descriptor
+        QTimer* timer;
+        QTime pendingTime;
+        QString root;
+        bool eolDetection;
+        bool indentDetection;
+        QByteArray codecName;
+        QIODevice* output;
+        QHash<QString, QSet<QString> > directoryFiles; // directory path -> file names
+        QSet<QString> editorConfigDirectories; // directories having a .editorconfig
+        QHash<QString, DocumentPropertiesDiscover::GuessedProperties> cache; // file path -> properties
+        QSet<QString> pendingFiles;
+        
+        bool watchDirectory( const QString& path );
+        void unwatchDirectory( const QString& path );
+        void watchFiles( const QStringList& filePaths );
+        void unwatchFile( const QString& filePath );
+        void watchFailure( const QString& path, const QString& reason );
+        void fileWritten( const QString& filePath );
+        void addDirectory( const QString& path, QStringList& filePaths );
+        void removeDirectory( const QString& path );
+        void removeFile( const QString& filePath );
+        void updateEditorConfig( const QString& path );
+        void editorConfigChanged( const QString& path );
+        void schedule( const QString& filePath );
+        void update( const QStringList& filePaths );
+        void publish( const QString& filePath, const QString& text );
+    
+    protected slots:
+        void directoryChanged( const QString& path );
+        void fileChanged( const QString& filePath );
+        void inotifyActivated();
+        void processPendingFiles();
+    
+    signals:
+        void propertiesChanged( const QString& filePath, const DocumentPropertiesDiscover::GuessedProperties& properties );
+        void fileRemoved( const QString& filePath );
+        void watchFailed( const QString& path );
+    };
+};
+
+#endif // DOCUMENTPROPERTIESWATCHER_H
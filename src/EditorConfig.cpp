@@ -0,0 +1,390 @@
+#include "EditorConfig.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <QStack>
+#include <QTextStream>
+
+namespace DocumentPropertiesDiscover {
+    struct EditorConfigSection {
+        QRegExp pattern; // compiled glob, matched against absolute file paths
+        QList<QPair<QString, QString> > properties;
+    };
+    
+    struct EditorConfigFile {
+        EditorConfigFile() {
+            root = false;
+        }
+        
+        bool root;
+        QList<DocumentPropertiesDiscover::EditorConfigSection> sections;
+    };
+    
+    QHash<QString, DocumentPropertiesDiscover::EditorConfigFile> editorConfigFiles; // directory -> parsed .editorconfig
+    QMutex editorConfigMutex;
+    
+    QString rangeToRegExp( int from, int to ) {
+        QStringList numbers;
+        
+        if ( from > to ) {
+            qSwap( from, to );
+        }
+        
+        // don't build huge alternations, match any integer instead
+        if ( to -from > 1000 ) {
+            return "[+-]?\\d+";
+        }
+        
+        for ( int i = from; i <= to; i++ ) {
+            numbers << QString::number( i );
+        }
+        
+        return QString( "(?:%1)" ).arg( numbers.join( "|" ) );
+    }
+    
+    int closingBraceIndex( const QString& glob, int index ) {
+        int depth = 0;
+        
+        for ( int i = index; i < glob.length(); i++ ) {
+            const QChar c = glob[ i ];
+            
+            if ( c == '\\' ) {
+                i++;
+            }
+            else if ( c == '{' ) {
+                depth++;
+            }
+            else if ( c == '}' ) {
+                depth--;
+                
+                if ( depth == 0 ) {
+                    return i;
+                }
+            }
+        }
+        
+        return -1;
+    }
+    
+    QString globToRegExp( const QString& glob ) {
+        QRegExp range_re( "^([+-]?\\d+)\\.\\.([+-]?\\d+)$" );
+        QStack<bool> braces; // true for an alternation group, false for literal braces
+        QString rx;
+        
+        for ( int i = 0; i < glob.length(); i++ ) {
+            const QChar c = glob[ i ];
+            
+            switch ( c.unicode() ) {
+                case '*':
+                    if ( i +1 < glob.length() && glob[ i +1 ] == '*' ) {
+                        rx.append( ".*" );
+                        i++;
+                    }
+                    else {
+                        rx.append( "[^/]*" );
+                    }
+                    break;
+                case '?':
+                    rx.append( "[^/]" );
+                    break;
+                case '[': {
+                    const int end = glob.indexOf( ']', i +1 );
+                    
+                    if ( end == -1 ) {
+                        rx.append( "\\[" );
+                        break;
+                    }
+                    
+                    QString set = glob.mid( i +1, end -i -1 );
+                    
+                    if ( set.startsWith( '!' ) ) {
+                        set[ 0 ] = '^';
+                    }
+                    
+                    rx.append( QString( "[%1]" ).arg( set.replace( "\\", "\\\\" ) ) );
+                    i = end;
+                    break;
+                }
+                case '{': {
+                    const int end = DocumentPropertiesDiscover::closingBraceIndex( glob, i );
+                    
+                    if ( end == -1 ) {
+                        rx.append( "\\{" );
+                        break;
+                    }
+                    
+                    const QString inner = glob.mid( i +1, end -i -1 );
+                    
+                    // numeric range
+                    if ( range_re.exactMatch( inner ) ) {
+                        rx.append( DocumentPropertiesDiscover::rangeToRegExp( range_re.cap( 1 ).toInt(), range_re.cap( 2 ).toInt() ) );
+                        i = end;
+                        break;
+                    }
+                    
+                    // braces without comma are literal
+                    const bool group = inner.contains( ',' );
+                    braces.push( group );
+                    rx.append( group ? "(?:" : "\\{" );
+                    break;
+                }
+                case '}':
+                    if ( braces.isEmpty() ) {
+                        rx.append( "\\}" );
+                    }
+                    else {
+                        rx.append( braces.pop() ? ")" : "\\}" );
+                    }
+                    break;
+                case ',':
+                    rx.append( !braces.isEmpty() && braces.top() ? "|" : "," );
+                    break;
+                case '\\':
+                    if ( i +1 < glob.length() ) {
+                        i++;
+                        rx.append( QRegExp::escape( glob.mid( i, 1 ) ) );
+                    }
+                    break;
+                default:
+                    rx.append( QRegExp::escape( QString( c ) ) );
+                    break;
+            }
+        }
+        
+        return rx;
+    }
+    
+    QRegExp sectionPattern( const QString& directory, QString glob ) {
+        QString prefix = QRegExp::escape( directory.endsWith( '/' ) ? directory : QString( "%1/" ).arg( directory ) );
+        
+        // globs without slash match files in any sub directory
+        if ( glob.contains( '/' ) ) {
+            if ( glob.startsWith( '/' ) ) {
+                glob.remove( 0, 1 );
+            }
+        }
+        else {
+            prefix.append( "(?:.*/)?" );
+        }
+        
+        return QRegExp( prefix +DocumentPropertiesDiscover::globToRegExp( glob ) );
+    }
+    
+    DocumentPropertiesDiscover::EditorConfigFile parseEditorConfig( const QString& directory ) {
+        DocumentPropertiesDiscover::EditorConfigFile editorConfig;
+        QFile file( QString( "%1/.editorconfig" ).arg( directory ) );
+        
+        if ( !file.exists() || !file.open( QIODevice::ReadOnly ) ) {
+            return editorConfig;
+        }
+        
+        QTextStream stream( &file );
+        stream.setCodec( "UTF-8" );
+        
+        while ( !stream.atEnd() ) {
+            const QString line = stream.readLine().trimmed();
+            
+            if ( line.isEmpty() || line.startsWith( '#' ) || line.startsWith( ';' ) ) {
+                continue;
+            }
+            
+            if ( line.startsWith( '[' ) && line.endsWith( ']' ) ) {
+                DocumentPropertiesDiscover::EditorConfigSection section;
+                section.pattern = DocumentPropertiesDiscover::sectionPattern( directory, line.mid( 1, line.length() -2 ) );
+                editorConfig.sections << section;
+                continue;
+            }
+            
+            const int index = line.indexOf( '=' );
+            
+            if ( index == -1 ) {
+                continue;
+            }
+            
+            const QString key = line.left( index ).trimmed().toLower();
+            const QString value = line.mid( index +1 ).trimmed().toLower();
+            
+            // preamble
+            if ( editorConfig.sections.isEmpty() ) {
+                if ( key == "root" ) {
+                    editorConfig.root = value == "true";
+                }
+            }
+            else {
+                editorConfig.sections.last().properties << qMakePair( key, value );
+            }
+        }
+        
+        return editorConfig;
+    }
+    
+    DocumentPropertiesDiscover::EditorConfigFile cachedEditorConfig( const QString& directory ) {
+        {
+            QMutexLocker locker( &DocumentPropertiesDiscover::editorConfigMutex );
+            QHash<QString, DocumentPropertiesDiscover::EditorConfigFile>::const_iterator it = DocumentPropertiesDiscover::editorConfigFiles.constFind( directory );
+            
+            if ( it != DocumentPropertiesDiscover::editorConfigFiles.constEnd() ) {
+                return it.value();
+            }
+        }
+        
+        const DocumentPropertiesDiscover::EditorConfigFile editorConfig = DocumentPropertiesDiscover::parseEditorConfig( directory );
+        
+        QMutexLocker locker( &DocumentPropertiesDiscover::editorConfigMutex );
+        DocumentPropertiesDiscover::editorConfigFiles[ directory ] = editorConfig;
+        return editorConfig;
+    }
+    
+    int toWidth( const QString& value ) {
+        bool ok;
+        const int width = value.toInt( &ok );
+        return ok && width > 0 ? width : -1;
+    }
+}
+
+// EditorConfigProperties
+
+DocumentPropertiesDiscover::EditorConfigProperties::EditorConfigProperties()
+{
+    eol = DocumentPropertiesDiscover::UndefinedEol;
+    indent = DocumentPropertiesDiscover::UndefinedIndent;
+    indentWidth = -1;
+    tabWidth = -1;
+}
+
+bool DocumentPropertiesDiscover::EditorConfigProperties::isEmpty() const
+{
+    return
+        eol == DocumentPropertiesDiscover::UndefinedEol &&
+        indent == DocumentPropertiesDiscover::UndefinedIndent &&
+        indentWidth == -1 &&
+        tabWidth == -1
+    ;
+}
+
+bool DocumentPropertiesDiscover::EditorConfigProperties::hasEol() const
+{
+    return eol != DocumentPropertiesDiscover::UndefinedEol;
+}
+
+bool DocumentPropertiesDiscover::EditorConfigProperties::hasIndent() const
+{
+    return indent != DocumentPropertiesDiscover::UndefinedIndent && indentWidth != -1 && tabWidth != -1;
+}
+
+DocumentPropertiesDiscover::GuessedProperties DocumentPropertiesDiscover::EditorConfigProperties::merged( const DocumentPropertiesDiscover::GuessedProperties& properties ) const
+{
+    DocumentPropertiesDiscover::GuessedProperties result = properties;
+    
+    if ( eol != DocumentPropertiesDiscover::UndefinedEol ) {
+        result.eol = eol;
+    }
+    
+    if ( indent != DocumentPropertiesDiscover::UndefinedIndent ) {
+        result.indent = indent;
+    }
+    
+    if ( indentWidth != -1 ) {
+        result.indentWidth = indentWidth;
+    }
+    
+    if ( tabWidth != -1 ) {
+        result.tabWidth = tabWidth;
+    }
+    
+    return result;
+}
+
+// DocumentPropertiesDiscover
+
+DocumentPropertiesDiscover::EditorConfigProperties DocumentPropertiesDiscover::editorConfigProperties( const QString& filePath )
+{
+    const QString path = QDir::cleanPath( QFileInfo( filePath ).absoluteFilePath() );
+    QList<DocumentPropertiesDiscover::EditorConfigFile> editorConfigs;
+    QString directory = QFileInfo( path ).path();
+    
+    // nearest files are applied last
+    forever {
+        const DocumentPropertiesDiscover::EditorConfigFile editorConfig = DocumentPropertiesDiscover::cachedEditorConfig( directory );
+        const QString parent = QFileInfo( directory ).path();
+        
+        editorConfigs.prepend( editorConfig );
+        
+        if ( editorConfig.root || parent == directory ) {
+            break;
+        }
+        
+        directory = parent;
+    }
+    
+    QHash<QString, QString> values;
+    
+    foreach ( const DocumentPropertiesDiscover::EditorConfigFile& editorConfig, editorConfigs ) {
+        foreach ( const DocumentPropertiesDiscover::EditorConfigSection& section, editorConfig.sections ) {
+            // QRegExp keeps its match state, use a local copy so that threads don't share it
+            QRegExp pattern = section.pattern;
+            
+            if ( !pattern.exactMatch( path ) ) {
+                continue;
+            }
+            
+            for ( int i = 0; i < section.properties.count(); i++ ) {
+                values[ section.properties[ i ].first ] = section.properties[ i ].second;
+            }
+        }
+    }
+    
+    DocumentPropertiesDiscover::EditorConfigProperties properties;
+    const QString indentStyle = values.value( "indent_style" );
+    const QString endOfLine = values.value( "end_of_line" );
+    QString indentSize = values.value( "indent_size" );
+    
+    if ( indentStyle == "tab" ) {
+        properties.indent = DocumentPropertiesDiscover::TabsIndent;
+        
+        if ( indentSize.isEmpty() ) {
+            indentSize = "tab";
+        }
+    }
+    else if ( indentStyle == "space" ) {
+        properties.indent = DocumentPropertiesDiscover::SpacesIndent;
+    }
+    
+    if ( endOfLine == "lf" ) {
+        properties.eol = DocumentPropertiesDiscover::UnixEol;
+    }
+    else if ( endOfLine == "crlf" ) {
+        properties.eol = DocumentPropertiesDiscover::DOSEol;
+    }
+    else if ( endOfLine == "cr" ) {
+        properties.eol = DocumentPropertiesDiscover::MacOSEol;
+    }
+    
+    properties.tabWidth = DocumentPropertiesDiscover::toWidth( values.value( "tab_width" ) );
+    properties.indentWidth = indentSize == "tab" ? properties.tabWidth : DocumentPropertiesDiscover::toWidth( indentSize );
+    
+    // tab_width defaults to indent_size
+    if ( properties.tabWidth == -1 ) {
+        properties.tabWidth = properties.indentWidth;
+    }
+    
+    return properties;
+}
+
+void DocumentPropertiesDiscover::clearEditorConfigCache()
+{
+    QMutexLocker locker( &DocumentPropertiesDiscover::editorConfigMutex );
+    DocumentPropertiesDiscover::editorConfigFiles.clear();
+}
+
+void DocumentPropertiesDiscover::invalidateEditorConfig( const QString& directory )
+{
+    const QString path = QDir::cleanPath( QFileInfo( directory ).absoluteFilePath() );
+    QMutexLocker locker( &DocumentPropertiesDiscover::editorConfigMutex );
+    DocumentPropertiesDiscover::editorConfigFiles.remove( path );
+}
@@ -0,0 +1,36 @@
+#ifndef EDITORCONFIG_H
+#define EDITORCONFIG_H
+
+#include "DocumentPropertiesDiscover.h"
+
+namespace DocumentPropertiesDiscover
+{
+    // properties declared by .editorconfig files, undeclared ones are UndefinedEol, UndefinedIndent or -1
+    struct DOCUMENTPROPERTIESDISCOVER_EXPORT EditorConfigProperties {
+        EditorConfigProperties();
+        
+        bool isEmpty() const;
+        bool hasEol() const;
+        bool hasIndent() const; // the indent and its widths are all declared
+        
+        // properties overridden by the declared ones
+        DocumentPropertiesDiscover::GuessedProperties merged( const DocumentPropertiesDiscover::GuessedProperties& properties ) const;
+        
+        int eol; // Eol flags
+        int indent; // Indent flags
+        int indentWidth; // indent size in spaces
+        int tabWidth; // tab size in spaces
+    };
+    
+    /*
+        Resolve the .editorconfig files from the filePath directory up to the root one.
+        Each .editorconfig is parsed once, its section globs compiled, and cached by directory.
+    */
+    DOCUMENTPROPERTIESDISCOVER_EXPORT DocumentPropertiesDiscover::EditorConfigProperties editorConfigProperties( const QString& filePath );
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void clearEditorConfigCache();
+    
+    // forget the cached .editorconfig of directory, once it has been created, modified or removed
+    DOCUMENTPROPERTIESDISCOVER_EXPORT void invalidateEditorConfig( const QString& directory );
+};
+
+#endif // EDITORCONFIG_H
@@ -0,0 +1,30 @@
+#ifndef TIMETRACKER_H
+#define TIMETRACKER_H
+
+#include <QTime>
+#include <QDebug>
+
+namespace DocumentPropertiesDiscover
+{
+    class TimeTracker : public QTime {
+    public:
+        TimeTracker( const QString& _name = QString::null ) {
+            name = _name;
+            start();
+            query( "ctor" );
+        }
+        
+        ~TimeTracker() {
+            query( "dtor" );
+        }
+        
+        void query( const QString& text = QString::null ) const {
+            qWarning() << qPrintable( name ) << "Elapsed time:" << ( elapsed() /1000.0 ) << qPrintable( text );
+        }
+    
+    protected:
+        QString name;
+    };
+};
+
+#endif // TIMETRACKER_H
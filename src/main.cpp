@@ -1,14 +1,121 @@
+#if defined( GUI_FRONTEND )
 #include <QtGui>
+#else
+#include <QtCore>
+#endif
 
 #include "DocumentPropertiesDiscover.h"
+#include "TimeTracker.h"
+#include "DocumentPropertiesWatcher.h"
+#include "BatchFileReader.h"
+
+// count the bytes handed by readFiles()
+class ByteCounter : public DocumentPropertiesDiscover::FileBufferHandler {
+public:
+    ByteCounter() {
+        bytes = 0;
+    }
+    
+    virtual void handleFileBuffer( int index, DocumentPropertiesDiscover::FileBufferHandler::Status status, const QByteArray& data ) {
+        Q_UNUSED( index );
+        Q_UNUSED( status );
+        QMutexLocker locker( &mutex );
+        bytes += data.size();
+    }
+    
+    QMutex mutex;
+    qint64 bytes;
+};
 
 int main( int argc, char** argv )
 {
+#if defined( GUI_FRONTEND )
     QApplication app( argc, argv );
     app.setApplicationName( "document-properties-discover" );
     QObject::connect( &app, SIGNAL( lastWindowClosed() ), &app, SLOT( quit() ) );
-
-    const QString path = QFileDialog::getExistingDirectory( 0, QString::null, QApplication::applicationDirPath() );
+#else
+    QCoreApplication app( argc, argv );
+    app.setApplicationName( "document-properties-discover" );
+#endif
+    
+    // the directory is the first argument that is not an option
+    QString path;
+    QString benchmark;
+    
+    foreach ( const QString& argument, app.arguments().mid( 1 ) ) {
+        if ( argument.startsWith( "--benchmark=" ) ) {
+            benchmark = argument.mid( 12 );
+        }
+        else if ( path.isEmpty() && !argument.startsWith( "--" ) ) {
+            path = argument;
+        }
+    }
+    
+#if defined( GUI_FRONTEND )
+    if ( path.isEmpty() ) {
+        path = QFileDialog::getExistingDirectory( 0, QString::null, QApplication::applicationDirPath() );
+    }
+#endif
+    
+    if ( path.isEmpty() || ( !benchmark.isEmpty() && benchmark != "qfile" && benchmark != "batch" ) ) {
+        qWarning( "Usage: %s [--watch|--benchmark=qfile|--benchmark=batch] directory", argv[ 0 ] );
+        return 1;
+    }
+    
+    /*
+        Time the per file QFile::readAll() loop or readFiles(), one backend per run so that each one can start from the same cache state.
+        readFiles() uses io_uring when available, run it again with DPD_NO_IO_URING=1 to time its thread pool fallback.
+        For cold cache numbers run "sync; echo 3 > /proc/sys/vm/drop_caches" before each run, for warm ones time a second run of the same backend.
+    */
+    if ( !benchmark.isEmpty() ) {
+        QStringList filePaths;
+        QDirIterator it( path, QDir::Files, QDirIterator::Subdirectories );
+        
+        while ( it.hasNext() ) {
+            filePaths << it.next();
+        }
+        
+        qWarning() << "Files:" << filePaths.count();
+        
+        if ( benchmark == "qfile" ) {
+            DocumentPropertiesDiscover::TimeTracker tracker( "QFile::readAll()" );
+            qint64 bytes = 0;
+            
+            foreach ( const QString& filePath, filePaths ) {
+                QFile file( filePath );
+                
+                if ( file.open( QIODevice::ReadOnly ) ) {
+                    bytes += file.readAll().size();
+                }
+            }
+            
+            tracker.query( QString( "%1 bytes" ).arg( bytes ) );
+        }
+        else {
+            DocumentPropertiesDiscover::TimeTracker tracker( "readFiles()" );
+            ByteCounter counter;
+            DocumentPropertiesDiscover::readFiles( filePaths, &counter, DocumentPropertiesDiscover::largeFileThreshold() );
+            tracker.query( QString( "%1 bytes, %2" ).arg( counter.bytes ).arg( qgetenv( "DPD_NO_IO_URING" ).isEmpty() ? "io_uring if available" : "thread pool" ) );
+        }
+        
+        return 0;
+    }
+    
+    // keep the properties of the whole tree up to date, results are written on stdout
+    if ( app.arguments().contains( "--watch" ) ) {
+        QFile output;
+        output.open( stdout, QIODevice::WriteOnly | QIODevice::Unbuffered );
+        
+        DocumentPropertiesDiscover::Watcher watcher;
+        watcher.setOutputDevice( &output );
+        
+        if ( !watcher.watch( path ) ) {
+            return 1;
+        }
+        
+        return app.exec();
+    }
+    
     QDir dir( path );
     const QFileInfoList files = dir.entryInfoList( QDir::Files );
     int count = 0;
@@ -20,6 +127,10 @@ int main( int argc, char** argv )
         
         DocumentPropertiesDiscover::GuessedProperties properties = DocumentPropertiesDiscover::guessFileProperties( fi.absoluteFilePath(), true, true );
         
+        if ( properties.binary ) {
+            continue;
+        }
+        
         qWarning() << qPrintable( fi.fileName() ) << qPrintable( properties.toString() );
         
         /*const int indent = DocumentPropertiesDiscover::MixedIndent;